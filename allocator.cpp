@@ -1,21 +1,84 @@
 #include "allocator.h"
 #include "memory.h"
+#include "string.h"
+#include "thread_cache_allocator.h"
 
 void* ch::Allocator::alloc(usize size) {
-    return func(*this, nullptr, size);
+    return func(*this, nullptr, 0, size, ch::default_alignment);
 }
 
 void* ch::Allocator::realloc(void* ptr, usize size) {
-    return func(*this, ptr, size);
+    return func(*this, ptr, 0, size, ch::default_alignment);
 }
 
 void ch::Allocator::free(void* ptr) {
-    func(*this, ptr, 0);
+    func(*this, ptr, 0, 0, ch::default_alignment);
 }
 
-static void* heap_alloc(const ch::Allocator& allocator, void* ptr, usize size) {
+void* ch::Allocator::alloc_aligned(usize size, usize alignment) {
+    assert(alignment && (alignment & (alignment - 1)) == 0);
+    return func(*this, nullptr, 0, size, alignment);
+}
+
+void* ch::Allocator::realloc_aligned(void* ptr, usize size, usize alignment) {
+    assert(alignment && (alignment & (alignment - 1)) == 0);
+    return func(*this, ptr, 0, size, alignment);
+}
+
+void ch::Allocator::free_aligned(void* ptr, usize alignment) {
+    func(*this, ptr, 0, 0, alignment);
+}
+
+void* ch::Allocator::realloc_sized(void* ptr, usize old_size, usize size, usize alignment) {
+    assert(alignment && (alignment & (alignment - 1)) == 0);
+    return func(*this, ptr, ptr ? old_size : 0, size, alignment);
+}
+
+void ch::Allocator::free_sized(void* ptr, usize old_size, usize alignment) {
+    func(*this, ptr, ptr ? old_size : 0, 0, alignment);
+}
+
+ch::Allocator_Stats ch::Allocator::get_stats() const {
+    if (!stats_func) return {};
+    return stats_func(*this);
+}
+
+/**
+ * malloc already gives default_alignment. Anything more is over allocated and the pointer malloc gave back is stashed
+ * right before the aligned one.
+ */
+static void* heap_alloc_over_aligned(void* ptr, usize size, usize alignment) {
     void* result = nullptr;
     if (size) {
+        const usize padding = alignment - 1 + sizeof(void*);
+        void* old_base = ptr ? ((void**)ptr)[-1] : nullptr;
+
+        u8* base = (u8*)(ptr ? ch_realloc(old_base, size + padding) : ch_malloc(size + padding));
+        if (!base) return nullptr;
+        result = ch::align_up(base + sizeof(void*), alignment);
+
+        // @NOTE(CHall): realloc may have moved us to a base with a different offset to the next aligned address
+        if (ptr) {
+            const usize old_offset = (u8*)ptr - (u8*)old_base;
+            const usize new_offset = (u8*)result - base;
+            if (old_offset != new_offset) ch::mem_move(result, base + old_offset, size);
+        }
+
+        ((void**)result)[-1] = base;
+    } else if (ptr) {
+        ch_free(((void**)ptr)[-1]);
+    }
+
+    return result;
+}
+
+static volatile u64 heap_num_failed_allocations = 0;
+
+static void* heap_alloc(const ch::Allocator& allocator, void* ptr, usize old_size, usize size, usize alignment) {
+    void* result = nullptr;
+    if (alignment > ch::default_alignment) {
+        result = heap_alloc_over_aligned(ptr, size, alignment);
+    } else if (size) {
         if (!ptr) {
             result = ch_malloc(size);
         } else {
@@ -25,64 +88,639 @@ static void* heap_alloc(const ch::Allocator& allocator, void* ptr, usize size) {
         ch_free(ptr);
     }
 
+    if (size && !result) ch::atomic_fetch_add(&heap_num_failed_allocations, 1);
+    return result;
+}
+
+/** The heap is shared by everything so this is the whole process, not just what went through this allocator */
+static ch::Allocator_Stats heap_stats(const ch::Allocator& allocator) {
+    ch::Allocator_Stats result = {};
+    ch::get_os_heap_usage(&result.bytes_in_use, &result.bytes_reserved);
+    result.num_failed_allocations = ch::atomic_load(&heap_num_failed_allocations);
+
+    if (ch::priv_thread_cache_in_use) {
+        const ch::Allocator_Stats thread_cache = ch::get_thread_cache_stats();
+        result.bytes_in_use += thread_cache.bytes_in_use;
+        result.bytes_reserved += thread_cache.bytes_reserved;
+    }
+
+#if CH_BUILD_DEBUG
+    result.num_allocations = ch::get_num_allocations();
+#endif
     return result;
 }
 
 // Use static initializer to avoid the static initialization order fiasco
-ch::Allocator ch::context_allocator = { nullptr, heap_alloc };
+thread_local ch::Allocator ch::context_allocator = { nullptr, heap_alloc, heap_stats };
+
+/** Whatever context_allocator was before each push on this thread */
+static thread_local ch::Allocator context_allocator_stack[ch::max_context_allocator_depth];
+static thread_local usize context_allocator_depth = 0;
+
+void ch::push_context_allocator(const ch::Allocator& allocator) {
+    assert(context_allocator_depth < ch::max_context_allocator_depth);
+    context_allocator_stack[context_allocator_depth] = ch::context_allocator;
+    context_allocator_depth += 1;
+    ch::context_allocator = allocator;
+}
+
+void ch::pop_context_allocator() {
+    assert(context_allocator_depth > 0);
+    context_allocator_depth -= 1;
+    ch::context_allocator = context_allocator_stack[context_allocator_depth];
+}
 
 ch::Allocator ch::get_heap_allocator() {
     ch::Allocator result;
     result.data = nullptr;
     result.func = heap_alloc;
+    result.stats_func = heap_stats;
     return result;
 }
 
-static void* arena_alloc(const ch::Allocator& allocator, void* ptr, usize size) {
+/** Virtual arenas commit at least this much at a time so growing isn't a syscall every few allocations */
+const usize arena_commit_granularity = 64 * 1024;
+
+static bool grow_virtual_arena(ch::Arena_Allocator_Header* header, usize needed) {
+    if (needed > header->reserved) return false;
+
+    usize new_allocated = ch::align_up(needed, arena_commit_granularity);
+    if (new_allocated > header->reserved) new_allocated = header->reserved;
+
+    if (!ch::commit_memory((u8*)header->data + header->allocated, new_allocated - header->allocated)) return false;
+    header->allocated = new_allocated;
+    return true;
+}
+
+static bool ensure_arena_space(ch::Arena_Allocator_Header* header, usize needed) {
+    if (needed <= header->allocated) return true;
+
+    // @NOTE(CHall): A fixed arena overflowing is a bug in how it was sized. A virtual one running out of its reservation fails like the heap does
+    assert(header->reserved);
+    if (header->reserved && grow_virtual_arena(header, needed)) return true;
+
+    header->num_failed_allocations += 1;
+    return false;
+}
+
+/** Every arena allocation is prefixed with its size so a realloc knows how much there is to copy */
+static CH_FORCEINLINE usize& get_arena_allocation_size(void* ptr) {
+    return ((usize*)ptr)[-1];
+}
+
+static void* arena_alloc(const ch::Allocator& allocator, void* ptr, usize old_size, usize size, usize alignment) {
     ch::Arena_Allocator_Header* header = allocator.get_header<ch::Arena_Allocator_Header>();
+    u8* const data = (u8*)header->data;
 
-    if (!ptr || (ptr && size > 0)) {
-        // @NOTE(Colby): this will assert if we're trying to free with a nullptr
-        assert(size > 0);
-        assert(header->current + size <= header->allocated);
-        u8* result = (u8*)header->data + header->current;
+    if (ptr) {
+        const usize offset = (u8*)ptr - data;
 
-		if (ptr) {
-			ch::mem_copy(result, ptr, size);
-		}
+        // @NOTE(CHall): Nothing comes after the last allocation so it can grow, shrink or be freed right where it is
+        if (offset == header->last) {
+            if (!size) {
+                header->current = offset - sizeof(usize);
+                header->last = 0;
+                return nullptr;
+            }
 
-        header->current += size;
-        return result;
-    } 
+            if (!ensure_arena_space(header, offset + size)) return nullptr;
+            get_arena_allocation_size(ptr) = size;
+            header->current = offset + size;
+            if (header->current > header->high_water) header->high_water = header->current;
+            return ptr;
+        }
+
+        // Anything else just stays where it is until the arena is reset
+        if (!size) return nullptr;
+    }
 
-	return nullptr;
+    // @NOTE(Colby): this will assert if we're trying to free with a nullptr
+    assert(size > 0);
+    const usize offset = ch::align_up((usize)data + header->current + sizeof(usize), alignment) - (usize)data;
+    if (!ensure_arena_space(header, offset + size)) return nullptr;
+
+    u8* result = data + offset;
+    get_arena_allocation_size(result) = size;
+
+    if (ptr) {
+        if (!old_size) old_size = get_arena_allocation_size(ptr);
+        ch::mem_copy(result, ptr, old_size < size ? old_size : size);
+    }
+
+    header->current = offset + size;
+    header->last = offset;
+    header->num_allocations += 1;
+    if (header->current > header->high_water) header->high_water = header->current;
+    return result;
+}
+
+static ch::Allocator_Stats arena_stats(const ch::Allocator& allocator) {
+    const ch::Arena_Allocator_Header* header = allocator.get_header<ch::Arena_Allocator_Header>();
+
+    ch::Allocator_Stats result = {};
+    result.bytes_in_use = header->current;
+    result.peak_bytes_in_use = header->high_water;
+    result.bytes_reserved = header->allocated;
+    result.num_allocations = header->num_allocations;
+    result.total_allocations = header->num_allocations;
+    result.num_failed_allocations = header->num_failed_allocations;
+    return result;
 }
 
 ch::Allocator ch::make_arena_allocator(usize size) {
-    u8* data = (u8*)ch_malloc(size + sizeof(ch::Arena_Allocator_Header));
+    // Keeps the first allocation from having to pad out to default_alignment
+    const usize header_size = ch::align_up(sizeof(ch::Arena_Allocator_Header), ch::default_alignment);
+
+    u8* data = (u8*)ch_malloc(size + header_size);
     ch::Arena_Allocator_Header* header = (ch::Arena_Allocator_Header*)data;
     *header = {};
-    header->data = data + sizeof(ch::Arena_Allocator_Header);
+    header->data = data + header_size;
     header->allocated = size;
 
-    return { data, arena_alloc };
+    return { data, arena_alloc, arena_stats };
+}
+
+ch::Allocator ch::make_virtual_arena_allocator(usize reserve_size, u32 vm_flags) {
+    // @NOTE(CHall): The header lives in the first page of the reservation so that page is committed straight away
+    const usize header_size = ch::get_page_size();
+    reserve_size = ch::align_up(reserve_size, header_size);
+
+    u8* data = (u8*)ch::reserve_memory(reserve_size + header_size, vm_flags);
+    if (!data) return {};
+    if (!ch::commit_memory(data, header_size)) {
+        ch::release_memory(data, reserve_size + header_size);
+        return {};
+    }
+
+    ch::Arena_Allocator_Header* header = (ch::Arena_Allocator_Header*)data;
+    *header = {};
+    header->data = data + header_size;
+    header->reserved = reserve_size;
+
+    return { data, arena_alloc, arena_stats };
 }
 
 void ch::free_arena_allocator(ch::Allocator* allocator) {
     ch::Arena_Allocator_Header* header = allocator->get_header<ch::Arena_Allocator_Header>();
-    ch_free(allocator->data);
+    if (header->reserved) {
+        const usize header_size = (u8*)header->data - allocator->data;
+        ch::release_memory(allocator->data, header->reserved + header_size);
+    } else {
+        ch_free(allocator->data);
+    }
     allocator->data = nullptr;
 }
 
-void ch::reset_arena_allocator(ch::Allocator* allocator) {
+void ch::reset_arena_allocator(ch::Allocator* allocator, bool decommit) {
     ch::Arena_Allocator_Header* header = allocator->get_header<ch::Arena_Allocator_Header>();
+
+    if (decommit && header->reserved) {
+        const usize keep = ch::align_up(header->high_water, arena_commit_granularity);
+        if (keep < header->allocated) {
+            ch::decommit_memory((u8*)header->data + keep, header->allocated - keep);
+            header->allocated = keep;
+        }
+    }
+
+    header->current = 0;
+    header->high_water = 0;
+    header->last = 0;
+    header->num_allocations = 0;
+    header->num_failed_allocations = 0;
+}
+
+ch::Temp_Arena ch::begin_temp(const ch::Allocator& arena) {
+    assert(arena.func == arena_alloc);
+    ch::Arena_Allocator_Header* header = arena.get_header<ch::Arena_Allocator_Header>();
+
+    ch::Temp_Arena result;
+    result.allocator = arena;
+    result.current = header->current;
+    result.last = header->last;
+
+    // @NOTE(CHall): Whatever was last before the temp can't grow into it or end_temp would cut it short
+    header->last = 0;
+    return result;
+}
+
+void ch::end_temp(const ch::Temp_Arena& temp) {
+    ch::Arena_Allocator_Header* header = temp.allocator.get_header<ch::Arena_Allocator_Header>();
+    assert(header->current >= temp.current);
+    header->current = temp.current;
+    header->last = temp.last;
+}
+
+const usize num_scratch_arenas = 2;
+const usize scratch_arena_reserve_size = 64 * 1024 * 1024;
+
+/** Scratch arenas are only address space until they're used so every thread gets its own */
+struct Scratch_Arenas {
+    ch::Allocator arenas[num_scratch_arenas] = {};
+
+    ~Scratch_Arenas() {
+        for (ch::Allocator& it : arenas) {
+            if (it) ch::free_arena_allocator(&it);
+        }
+    }
+};
+
+static thread_local Scratch_Arenas scratch_arenas;
+
+ch::Temp_Arena ch::begin_scratch(const ch::Allocator* conflict) {
+    for (ch::Allocator& it : scratch_arenas.arenas) {
+        if (!it) it = ch::make_virtual_arena_allocator(scratch_arena_reserve_size);
+        if (conflict && it.data == conflict->data) continue;
+
+        return ch::begin_temp(it);
+    }
+
+    invalid_code_path;
+    return {};
+}
+
+static volatile u64 next_concurrent_arena_generation = 1;
+
+/** This threads piece of some concurrent arena */
+struct Concurrent_Arena_Chunk {
+    const ch::Concurrent_Arena_Header* header;
+    u64 generation;
+    u8* current;
+    u8* end;
+
+    /** Most recent allocation. The only one that can be resized in place */
+    u8* last;
+};
+
+/** Threads rarely allocate out of more than a couple concurrent arenas at once. Past this they just take turns */
+const usize max_concurrent_arena_chunks = 4;
+
+static thread_local Concurrent_Arena_Chunk concurrent_arena_chunks[max_concurrent_arena_chunks];
+static thread_local usize next_concurrent_arena_chunk = 0;
+
+static Concurrent_Arena_Chunk* get_concurrent_arena_chunk(const ch::Concurrent_Arena_Header* header) {
+    const u64 generation = ch::atomic_load(&header->generation);
+    for (Concurrent_Arena_Chunk& it : concurrent_arena_chunks) {
+        if (it.header == header && it.generation == generation) return &it;
+    }
+
+    Concurrent_Arena_Chunk* result = &concurrent_arena_chunks[next_concurrent_arena_chunk];
+    next_concurrent_arena_chunk = (next_concurrent_arena_chunk + 1) % max_concurrent_arena_chunks;
+
+    *result = {};
+    result->header = header;
+    result->generation = generation;
+    return result;
+}
+
+/** @returns the start of size bytes nobody else will ever be handed or nullptr when the reservation is used up */
+static u8* claim_concurrent_arena_space(ch::Concurrent_Arena_Header* header, usize size) {
+    const usize offset = ch::atomic_fetch_add(&header->current, (u64)size);
+    const usize end = offset + size;
+    if (end > header->reserved) return nullptr;
+
+    if (end > ch::atomic_load(&header->committed)) {
+        header->commit_lock.lock();
+        defer(header->commit_lock.unlock());
+
+        const usize committed = ch::atomic_load(&header->committed);
+        if (end > committed) {
+            usize new_committed = ch::align_up(end, arena_commit_granularity);
+            if (new_committed > header->reserved) new_committed = header->reserved;
+
+            if (!ch::commit_memory((u8*)header->data + committed, new_committed - committed)) return nullptr;
+            ch::atomic_store(&header->committed, (u64)new_committed);
+        }
+    }
+
+    return (u8*)header->data + offset;
+}
+
+static void* concurrent_arena_alloc(const ch::Allocator& allocator, void* ptr, usize old_size, usize size, usize alignment) {
+    ch::Concurrent_Arena_Header* header = allocator.get_header<ch::Concurrent_Arena_Header>();
+    Concurrent_Arena_Chunk* chunk = get_concurrent_arena_chunk(header);
+
+    if (ptr) {
+        if (ptr == chunk->last) {
+            if (!size) {
+                chunk->current = chunk->last - sizeof(usize);
+                chunk->last = nullptr;
+                return nullptr;
+            }
+
+            if ((u8*)ptr + size <= chunk->end) {
+                get_arena_allocation_size(ptr) = size;
+                chunk->current = (u8*)ptr + size;
+                return ptr;
+            }
+        }
+
+        if (!size) return nullptr;
+    }
+
+    assert(size > 0);
+    u8* result = (u8*)ch::align_up(chunk->current + sizeof(usize), alignment);
+    bool in_chunk = chunk->current && result + size <= chunk->end;
+    if (!in_chunk) {
+        const usize needed = sizeof(usize) + alignment + size;
+        if (needed > header->sub_chunk_size / 4) {
+            // Big enough that it gets its own space. Whatever is left of this threads sub chunk is still good
+            u8* space = claim_concurrent_arena_space(header, ch::align_up(needed, ch::default_alignment));
+            if (!space) {
+                ch::atomic_fetch_add(&header->num_failed_allocations, 1);
+                return nullptr;
+            }
+            result = (u8*)ch::align_up(space + sizeof(usize), alignment);
+        } else {
+            u8* space = claim_concurrent_arena_space(header, header->sub_chunk_size);
+            if (!space) {
+                ch::atomic_fetch_add(&header->num_failed_allocations, 1);
+                return nullptr;
+            }
+            chunk->current = space;
+            chunk->end = space + header->sub_chunk_size;
+            result = (u8*)ch::align_up(chunk->current + sizeof(usize), alignment);
+            in_chunk = true;
+        }
+    }
+
+    get_arena_allocation_size(result) = size;
+    if (ptr) {
+        if (!old_size) old_size = get_arena_allocation_size(ptr);
+        ch::mem_copy(result, ptr, old_size < size ? old_size : size);
+    }
+
+    if (in_chunk) {
+        chunk->current = result + size;
+        chunk->last = result;
+    }
+    ch::atomic_fetch_add(&header->total_allocations, 1);
+    return result;
+}
+
+/** Sub chunks count as in use as soon as a thread claims one */
+static ch::Allocator_Stats concurrent_arena_stats(const ch::Allocator& allocator) {
+    const ch::Concurrent_Arena_Header* header = allocator.get_header<ch::Concurrent_Arena_Header>();
+
+    ch::Allocator_Stats result = {};
+    result.bytes_in_use = ch::atomic_load(&header->current);
+    if (result.bytes_in_use > header->reserved) result.bytes_in_use = header->reserved;
+    result.peak_bytes_in_use = result.bytes_in_use;
+    result.bytes_reserved = ch::atomic_load(&header->committed);
+    result.num_allocations = ch::atomic_load(&header->total_allocations);
+    result.total_allocations = result.num_allocations;
+    result.num_failed_allocations = ch::atomic_load(&header->num_failed_allocations);
+    return result;
+}
+
+ch::Allocator ch::make_concurrent_arena_allocator(usize reserve_size, usize sub_chunk_size, u32 vm_flags) {
+    assert(sub_chunk_size >= 1024);
+
+    const usize header_size = ch::get_page_size();
+    reserve_size = ch::align_up(reserve_size, header_size);
+
+    u8* data = (u8*)ch::reserve_memory(reserve_size + header_size, vm_flags);
+    if (!data) return {};
+    if (!ch::commit_memory(data, header_size)) {
+        ch::release_memory(data, reserve_size + header_size);
+        return {};
+    }
+
+    ch::Concurrent_Arena_Header* header = (ch::Concurrent_Arena_Header*)data;
+    *header = {};
+    header->data = data + header_size;
+    header->reserved = reserve_size;
+    header->sub_chunk_size = ch::align_up(sub_chunk_size, ch::default_alignment);
+    header->generation = ch::atomic_fetch_add(&next_concurrent_arena_generation, 1);
+
+    return { data, concurrent_arena_alloc, concurrent_arena_stats };
+}
+
+void ch::free_concurrent_arena_allocator(ch::Allocator* allocator) {
+    ch::Concurrent_Arena_Header* header = allocator->get_header<ch::Concurrent_Arena_Header>();
+    const usize header_size = (u8*)header->data - allocator->data;
+    ch::release_memory(allocator->data, header->reserved + header_size);
+    allocator->data = nullptr;
+}
+
+void ch::reset_concurrent_arena_allocator(ch::Allocator* allocator) {
+    ch::Concurrent_Arena_Header* header = allocator->get_header<ch::Concurrent_Arena_Header>();
+
+    // @NOTE(CHall): Every thread still holding a sub chunk sees the generation change and claims a new one
+    ch::atomic_store(&header->current, 0);
+    ch::atomic_store(&header->total_allocations, 0);
+    ch::atomic_store(&header->num_failed_allocations, 0);
+    ch::atomic_store(&header->generation, ch::atomic_fetch_add(&next_concurrent_arena_generation, 1));
+}
+
+/** top once nothing is known to be on top. Sizes aren't stored so after a free there's no telling where the one under it starts */
+const usize stack_no_top = (usize)-1;
+
+/** Markers above current point at memory that's already been freed so popping one would bring it back */
+static void drop_stack_markers_above(ch::Stack_Allocator_Header* header) {
+    while (header->num_markers && header->markers[header->num_markers - 1].current > header->current) {
+        header->num_markers -= 1;
+    }
+}
+
+static void* stack_alloc(const ch::Allocator& allocator, void* ptr, usize old_size, usize size, usize alignment) {
+    ch::Stack_Allocator_Header* header = allocator.get_header<ch::Stack_Allocator_Header>();
+    u8* const data = (u8*)header->data;
+
+    if (ptr) {
+        const usize offset = (u8*)ptr - data;
+        assert(offset < header->current);
+
+        // @NOTE(CHall): Whatever was allocated after ptr is popped with it
+        if (!size) {
+            header->current = offset;
+            header->top = stack_no_top;
+            drop_stack_markers_above(header);
+            return nullptr;
+        }
+
+        if (offset == header->top) {
+            assert(offset + size <= header->allocated);
+            if (offset + size > header->allocated) {
+                header->num_failed_allocations += 1;
+                return nullptr;
+            }
+
+            header->current = offset + size;
+            if (header->current > header->high_water) header->high_water = header->current;
+            return ptr;
+        }
+
+        // Sizes aren't stored so without one the most this could have been is everything up to the top of the stack
+        const usize max_size = header->current - offset;
+        if (!old_size || old_size > max_size) old_size = max_size;
+    }
+
+    // @NOTE(Colby): this will assert if we're trying to free with a nullptr
+    assert(size > 0);
+    const usize offset = ch::align_up((usize)data + header->current, alignment) - (usize)data;
+    assert(offset + size <= header->allocated);
+    if (offset + size > header->allocated) {
+        header->num_failed_allocations += 1;
+        return nullptr;
+    }
+
+    u8* result = data + offset;
+    if (ptr) {
+        ch::mem_copy(result, ptr, old_size < size ? old_size : size);
+    }
+
+    header->current = offset + size;
+    header->top = offset;
+    header->num_allocations += 1;
+    if (header->current > header->high_water) header->high_water = header->current;
+    return result;
+}
+
+static ch::Allocator_Stats stack_stats(const ch::Allocator& allocator) {
+    const ch::Stack_Allocator_Header* header = allocator.get_header<ch::Stack_Allocator_Header>();
+
+    ch::Allocator_Stats result = {};
+    result.bytes_in_use = header->current;
+    result.peak_bytes_in_use = header->high_water;
+    result.bytes_reserved = header->allocated;
+    result.total_allocations = header->num_allocations;
+    result.num_failed_allocations = header->num_failed_allocations;
+    return result;
+}
+
+ch::Allocator ch::make_stack_allocator(usize size) {
+    const usize header_size = ch::align_up(sizeof(ch::Stack_Allocator_Header), ch::default_alignment);
+
+    u8* data = (u8*)ch_malloc(size + header_size);
+    ch::Stack_Allocator_Header* header = (ch::Stack_Allocator_Header*)data;
+    *header = {};
+    header->data = data + header_size;
+    header->allocated = size;
+    header->top = stack_no_top;
+
+    return { data, stack_alloc, stack_stats };
+}
+
+void ch::free_stack_allocator(ch::Allocator* allocator) {
+    ch_free(allocator->data);
+    allocator->data = nullptr;
+}
+
+void ch::reset_stack_allocator(ch::Allocator* allocator) {
+    ch::Stack_Allocator_Header* header = allocator->get_header<ch::Stack_Allocator_Header>();
     header->current = 0;
+    header->top = stack_no_top;
+    header->num_markers = 0;
+    header->high_water = 0;
+    header->num_allocations = 0;
+    header->num_failed_allocations = 0;
+}
+
+void ch::push_stack_marker(const ch::Allocator& allocator, const char* name) {
+    ch::Stack_Allocator_Header* header = allocator.get_header<ch::Stack_Allocator_Header>();
+    assert(header->num_markers < ch::max_stack_markers);
+    if (header->num_markers == ch::max_stack_markers) return;
+
+    ch::Stack_Marker& marker = header->markers[header->num_markers];
+    marker.name = name;
+    marker.current = header->current;
+    header->num_markers += 1;
+
+    // @NOTE(CHall): Growing the top in place would run over the marker and popping it would cut the top short
+    header->top = stack_no_top;
 }
 
-static void* stack_alloc(const ch::Allocator& allocator, void* ptr, usize size) { return ptr; }
+bool ch::pop_stack_marker(const ch::Allocator& allocator, const char* name) {
+    ch::Stack_Allocator_Header* header = allocator.get_header<ch::Stack_Allocator_Header>();
+
+    for (usize i = header->num_markers; i > 0; i--) {
+        const ch::Stack_Marker& marker = header->markers[i - 1];
+        if (marker.name != name && !ch::streq(marker.name, name)) continue;
+
+        if (marker.current < header->current) header->current = marker.current;
+        header->top = stack_no_top;
+        header->num_markers = i - 1;
+        return true;
+    }
+
+    return false;
+}
+
+static void* null_alloc(const ch::Allocator& allocator, void* ptr, usize old_size, usize size, usize alignment) { return ptr; }
+
+ch::Allocator ch::get_null_allocator() {
+	return { nullptr, null_alloc };
+}
+
+/** Big enough for the size and keeps default_alignment. Over aligned allocations use their alignment instead */
+const usize counting_prefix_size = ch::default_alignment;
+
+static CH_FORCEINLINE usize get_counting_prefix_size(usize alignment) {
+	return alignment > counting_prefix_size ? alignment : counting_prefix_size;
+}
+
+static void* counting_alloc(const ch::Allocator& allocator, void* ptr, usize old_size, usize size, usize alignment) {
+	ch::Counting_Allocator_Header* header = allocator.get_header<ch::Counting_Allocator_Header>();
+	ch::Allocator_Stats& stats = header->stats;
+	const usize prefix_size = get_counting_prefix_size(alignment);
+
+	u8* base = nullptr;
+	if (ptr) {
+		base = (u8*)ptr - prefix_size;
+		assert(!old_size || old_size == ((usize*)ptr)[-1]);
+		old_size = ((usize*)ptr)[-1];
+	}
+
+	if (!size) {
+		if (ptr) {
+			header->wrapped.free_sized(base, old_size + prefix_size, alignment);
+			stats.bytes_in_use -= old_size;
+			stats.num_allocations -= 1;
+		}
+		return nullptr;
+	}
+
+	u8* new_base = (u8*)header->wrapped.realloc_sized(base, old_size + prefix_size, size + prefix_size, alignment);
+	if (!new_base) {
+		stats.num_failed_allocations += 1;
+		return nullptr;
+	}
+
+	u8* result = new_base + prefix_size;
+	((usize*)result)[-1] = size;
+
+	stats.bytes_in_use += size - old_size;
+	if (stats.bytes_in_use > stats.peak_bytes_in_use) stats.peak_bytes_in_use = stats.bytes_in_use;
+	if (!ptr) {
+		stats.num_allocations += 1;
+		stats.total_allocations += 1;
+	}
+	return result;
+}
+
+static ch::Allocator_Stats counting_stats(const ch::Allocator& allocator) {
+	const ch::Counting_Allocator_Header* header = allocator.get_header<ch::Counting_Allocator_Header>();
+
+	ch::Allocator_Stats result = header->stats;
+	const ch::Allocator_Stats wrapped = header->wrapped.get_stats();
+	result.bytes_reserved = wrapped.bytes_reserved;
+	result.fragmentation = wrapped.fragmentation;
+	return result;
+}
+
+ch::Allocator ch::make_counting_allocator(const ch::Allocator& wrapped) {
+	ch::Counting_Allocator_Header* header = (ch::Counting_Allocator_Header*)ch_malloc(sizeof(ch::Counting_Allocator_Header));
+	if (!header) return {};
+
+	*header = {};
+	header->wrapped = wrapped;
+
+	return { (u8*)header, counting_alloc, counting_stats };
+}
 
-ch::Allocator ch::get_stack_allocator() {
-	return { nullptr, stack_alloc };
+void ch::free_counting_allocator(ch::Allocator* allocator) {
+	ch_free(allocator->data);
+	allocator->data = nullptr;
 }
 
 void* operator new(usize size, ch::Allocator allocator) {
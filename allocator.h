@@ -1,20 +1,55 @@
 #pragma once
 
 #include "types.h"
+#include "atomics.h"
 
 namespace ch {
+    /** What malloc guarantees on 64 bit and what every allocator gives when no alignment is asked for */
+    const usize default_alignment = 16;
+
+    /**
+     * Usage an allocator reports about itself
+     *
+     * Anything an allocator has no way of knowing is left at 0. Arenas and stacks only give memory back from the top so
+     * everything they've handed out since the last reset counts as live.
+     */
+    struct Allocator_Stats {
+        /** Bytes handed out and not freed yet */
+        usize bytes_in_use;
+        usize peak_bytes_in_use;
+
+        /** Bytes held from the os or the backing allocator whether they're handed out or not */
+        usize bytes_reserved;
+
+        usize num_allocations;
+        usize total_allocations;
+        usize num_failed_allocations;
+
+        /** 0 when all the free space is in one piece. Gets closer to 1 the more it's split up */
+        f32 fragmentation;
+    };
+
     /**
      * Allocator concept
      * 
      * All actual allocator data is stored inside the allocators data as a header
      * We can throw this around anyway we like and it should always work
+     *
+     * alignment is always a power of 2. Reallocs and frees have to pass the same alignment the allocation was made with.
+     *
+     * old_size is the size ptr was last allocated or reallocated with when the caller knows it and 0 when it doesn't.
+     * Allocators are free to trust it so never pass anything else. Every allocator still has to handle 0.
      */
     struct Allocator {
-        using Allocator_Func = void* (*)(const Allocator& allocator, void* ptr, usize size);
+        using Allocator_Func = void* (*)(const Allocator& allocator, void* ptr, usize old_size, usize size, usize alignment);
+        using Stats_Func = ch::Allocator_Stats (*)(const Allocator& allocator);
         
         u8* data;
         Allocator_Func func;
 
+        /** Optional. get_stats returns all zeros without it */
+        Stats_Func stats_func = nullptr;
+
         explicit operator bool() const {
             return func != nullptr;
         }
@@ -23,6 +58,16 @@ namespace ch {
         void* realloc(void* ptr, usize size);
         void free(void* ptr);
 
+        void* alloc_aligned(usize size, usize alignment);
+        void* realloc_aligned(void* ptr, usize size, usize alignment);
+        void free_aligned(void* ptr, usize alignment);
+
+        /** For when the caller already knows how big ptr is. Saves allocators from having to look it up */
+        void* realloc_sized(void* ptr, usize old_size, usize size, usize alignment = ch::default_alignment);
+        void free_sized(void* ptr, usize old_size, usize alignment = ch::default_alignment);
+
+        ch::Allocator_Stats get_stats() const;
+
         template <typename T> 
         T* get_header() const {
             return (T*)data;
@@ -35,16 +80,175 @@ namespace ch {
         usize allocated;
         usize current;
         void* data;
+
+        /** Only set for virtual arenas. allocated is how much of this is committed right now */
+        usize reserved;
+
+        /** Highest current has reached since the last reset */
+        usize high_water;
+
+        /** Offset of the most recent allocation which can be resized or freed in place. 0 when there isn't one */
+        usize last;
+
+        /** Both since the last reset */
+        usize num_allocations;
+        usize num_failed_allocations;
     };
 
     ch::Allocator make_arena_allocator(usize size);
+
+    /**
+     * Reserves reserve_size bytes of address space and commits pages as current moves through them
+     * 
+     * Nothing is ever copied when it grows so pointers into it stay valid. Allocations return nullptr once the
+     * reservation is used up. vm_flags are Virtual_Memory_Flags.
+     */
+    ch::Allocator make_virtual_arena_allocator(usize reserve_size, u32 vm_flags = 0);
     void free_arena_allocator(ch::Allocator* allocator);
-    void reset_arena_allocator(ch::Allocator* allocator);
 
-	/** Essentially an empty allocator to prevent seg faults. */
-	ch::Allocator get_stack_allocator();
+    /** 
+     * decommit only does something for virtual arenas. Anything committed past the high water mark of the cycle 
+     * that just ended is given back to the os so a single spike doesn't hold onto its memory forever.
+     */
+    void reset_arena_allocator(ch::Allocator* allocator, bool decommit = false);
+
+    /**
+     * Checkpoint of an arena
+     * 
+     * end_temp rolls the arena back to where it was at begin_temp. Everything allocated out of it in between is gone.
+     * Temps on the same arena have to end in the reverse order they began.
+     */
+    struct Temp_Arena {
+        ch::Allocator allocator;
+        usize current;
+        usize last;
+    };
+
+    ch::Temp_Arena begin_temp(const ch::Allocator& arena);
+    void end_temp(const ch::Temp_Arena& temp);
+
+    struct Temp_Arena_Scope {
+        ch::Temp_Arena temp;
+
+        explicit Temp_Arena_Scope(const ch::Allocator& arena) : temp(ch::begin_temp(arena)) {}
+        ~Temp_Arena_Scope() { ch::end_temp(temp); }
+    };
+
+    /**
+     * Temp on one of this threads scratch arenas
+     * 
+     * If you're already allocating out of a scratch arena further up the stack pass it as conflict so you get the 
+     * other one back. Otherwise the inner end_temp would free the outer allocations.
+     */
+    ch::Temp_Arena begin_scratch(const ch::Allocator* conflict = nullptr);
+
+    struct Concurrent_Arena_Header {
+        void* data;
+        usize reserved;
+        usize sub_chunk_size;
+
+        /** Everything below this has been handed to some thread. Only ever moved with an atomic add */
+        volatile u64 current;
+
+        /** Only grows under commit_lock but it's read without it to skip the lock */
+        volatile u64 committed;
+        ch::Spin_Lock commit_lock;
+
+        /** Unique across every concurrent arena. A new one on every reset so threads know their sub chunk is stale */
+        volatile u64 generation;
+
+        /** Only ever bumped with an atomic add. Nothing is ever freed so every allocation is still in use */
+        volatile u64 total_allocations;
+        volatile u64 num_failed_allocations;
+    };
+
+    /**
+     * Arena that any number of threads can allocate out of at the same time without a lock
+     *
+     * Each thread claims a sub chunk of sub_chunk_size at a time with an atomic add and bumps through it on its own.
+     * Allocations bigger than a quarter of a sub chunk claim their own space the same way. Like a virtual arena it
+     * reserves reserve_size up front and commits as it goes so pointers stay valid until it's reset or freed.
+     *
+     * Frees do nothing. A realloc of the last thing a thread allocated can grow or shrink in place.
+     */
+    ch::Allocator make_concurrent_arena_allocator(usize reserve_size, usize sub_chunk_size = 64 * 1024, u32 vm_flags = 0);
+    void free_concurrent_arena_allocator(ch::Allocator* allocator);
+
+    /** No other thread can be allocating out of it while this runs */
+    void reset_concurrent_arena_allocator(ch::Allocator* allocator);
+
+    const usize max_stack_markers = 32;
+
+    struct Stack_Marker {
+        const char* name;
+        usize current;
+    };
+
+    struct Stack_Allocator_Header {
+        usize allocated;
+        usize current;
+        void* data;
+
+        /** Offset of the allocation on top which can be resized in place. Nothing can be after a free, pop or push */
+        usize top;
+
+        ch::Stack_Marker markers[max_stack_markers];
+        usize num_markers;
+
+        /** All since the last reset */
+        usize high_water;
+        usize num_allocations;
+        usize num_failed_allocations;
+    };
+
+    /**
+     * Linear LIFO allocator
+     *
+     * Nothing is stored per allocation. Freeing a pointer pops it along with everything allocated after it. The top
+     * allocation can grow and shrink in place. Anything under it has to move to grow.
+     */
+    ch::Allocator make_stack_allocator(usize size);
+    void free_stack_allocator(ch::Allocator* allocator);
+    void reset_stack_allocator(ch::Allocator* allocator);
+
+    /** Pushes a marker at the current top of the stack. Markers can have the same name, the most recent one wins */
+    void push_stack_marker(const ch::Allocator& allocator, const char* name);
+
+    /** Pops everything allocated since the named marker was pushed along with the marker and any pushed after it */
+    bool pop_stack_marker(const ch::Allocator& allocator, const char* name);
+
+	/** Essentially an empty allocator to prevent seg faults. Frees do nothing. For wrapping memory you don't own */
+	ch::Allocator get_null_allocator();
+
+	struct Counting_Allocator_Header {
+		ch::Allocator wrapped;
+		ch::Allocator_Stats stats;
+	};
+
+	/**
+	 * Passes everything through to wrapped and keeps full stats on what went through it
+	 *
+	 * Every allocation gets a small size prefix so frees can be counted. bytes_reserved and fragmentation come from
+	 * wrapped. Nothing is thread safe unless wrapped is and even then the counts can race.
+	 */
+	ch::Allocator make_counting_allocator(const ch::Allocator& wrapped);
+	void free_counting_allocator(ch::Allocator* allocator);
+
+	/**
+	 * What every container allocates with when it isn't handed an allocator. Each thread has its own and it starts out
+	 * as the heap allocator. Set it directly or push and pop to put it back the way it was.
+	 */
+	extern thread_local Allocator context_allocator;
+
+	const usize max_context_allocator_depth = 32;
+
+	void push_context_allocator(const ch::Allocator& allocator);
+	void pop_context_allocator();
 
-	extern Allocator context_allocator;
+	struct Context_Allocator_Scope {
+		explicit Context_Allocator_Scope(const ch::Allocator& allocator) { ch::push_context_allocator(allocator); }
+		~Context_Allocator_Scope() { ch::pop_context_allocator(); }
+	};
 }
 
 void* operator new(usize size, ch::Allocator allocator);
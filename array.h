@@ -4,8 +4,42 @@
 #include "memory.h"
 #include "templates.h"
 #include <initializer_list>
+#include <new>
 
 namespace ch {
+    /**
+     * Moves count elements from src to dest where the two can overlap. Anything in dest is written over without being
+     * destroyed and src is left as raw memory.
+     */
+    template <typename T>
+    void relocate(T* dest, T* src, usize count) {
+        if (dest == src || !count) return;
+
+        if (ch::is_trivially_relocatable<T>::value) {
+            ch::mem_move(dest, src, count * sizeof(T));
+            return;
+        }
+
+        if (dest < src) {
+            for (usize i = 0; i < count; i++) {
+                new (dest + i) T(ch::move(src[i]));
+                src[i].~T();
+            }
+        } else {
+            for (usize i = count; i > 0; i--) {
+                new (dest + i - 1) T(ch::move(src[i - 1]));
+                src[i - 1].~T();
+            }
+        }
+    }
+
+    /**
+     * Growable array
+     *
+     * Elements aren't destroyed when they're removed or when the array is freed, the same as every other container here.
+     * They only get their constructors and destructors run when the array has to move them. Anything that isn't
+     * trivially relocatable is moved one at a time with its move constructor instead of the mem functions.
+     */
     template <typename T>
     struct Array {
         T* data;
@@ -13,19 +47,25 @@ namespace ch {
         usize allocated;
         ch::Allocator allocator;
 
-        Array(const ch::Allocator& in_alloc = ch::context_allocator) : data(nullptr), count(0), allocated(0), allocator(in_alloc) {}
+        /** 
+         * 0 means the allocators default or alignof(T) if that's bigger. Bump it to 16/32/64 for simd or to keep
+         * elements off of shared cache lines. Only change it while nothing is allocated.
+         */
+        usize alignment;
+
+        Array(const ch::Allocator& in_alloc = ch::context_allocator) : data(nullptr), count(0), allocated(0), allocator(in_alloc), alignment(0) {}
 
         Array(std::initializer_list<T> init_list, const Allocator& in_alloc = ch::context_allocator)
-            : data(nullptr), count(0), allocated(0), allocator(in_alloc) {
+            : data(nullptr), count(0), allocated(0), allocator(in_alloc), alignment(0) {
             reserve(init_list.size());
             for (const T& item : init_list) {
-                data[count] = ch::move(item);
+                new (data + count) T(item);
                 count += 1;
             }
         }
 
         explicit Array(usize amount, const ch::Allocator& in_alloc = ch::context_allocator)
-            : data(nullptr), count(0), allocated(0), allocator(in_alloc) {
+            : data(nullptr), count(0), allocated(0), allocator(in_alloc), alignment(0) {
             reserve(amount);
         }
 
@@ -33,15 +73,22 @@ namespace ch {
             Array<T> result;
             result.count = count;
             result.allocator = in_alloc;
+            result.alignment = alignment;
 			result.reserve(count);
-            ch::mem_copy(result.data, data, count * sizeof(T));
+            if (ch::is_trivially_copyable<T>::value) {
+                ch::mem_copy(result.data, data, count * sizeof(T));
+            } else {
+                for (usize i = 0; i < count; i++) {
+                    new (result.data + i) T(data[i]);
+                }
+            }
             return result;
         }
 
         void free() {
             if (data) {
                 assert(allocator && allocated);
-                allocator.free(data);
+                allocator.free_sized(data, allocated * sizeof(T), get_alignment());
                 data = nullptr;
             }
             count = 0;
@@ -66,6 +113,11 @@ namespace ch {
 
         operator bool() const { return data && allocated; }
 
+        usize get_alignment() const {
+            usize result = alignment > alignof(T) ? alignment : alignof(T);
+            return result > ch::default_alignment ? result : ch::default_alignment;
+        }
+
         T& operator[](usize index) {
             assert(index < count);
             return data[index];
@@ -79,6 +131,10 @@ namespace ch {
         bool operator==(const Array<T>& right) const {
             if (count != right.count) return false;
 
+            if (ch::is_bitwise_comparable<T>::value) {
+                return ch::mem_equal(data, right.data, count * sizeof(T));
+            }
+
             for (usize i = 0; i < count; i++) {
                 if (data[i] != right[i]) return false;
             }
@@ -92,16 +148,23 @@ namespace ch {
 
         void reserve(usize size) {
             // @TODO(CHall): find the best way to preallocate
+            const usize old_allocated = allocated;
             usize new_count = allocated + size;
             while (allocated < new_count) {
                 allocated += allocated >> 1;
                 allocated += 1;
             }
 
-            if (data) {
-                data = (T*)allocator.realloc(data, allocated * sizeof(T));
+            if (!data) {
+                data = (T*)allocator.alloc_aligned(allocated * sizeof(T), get_alignment());
+            } else if (ch::is_trivially_relocatable<T>::value) {
+                data = (T*)allocator.realloc_sized(data, old_allocated * sizeof(T), allocated * sizeof(T), get_alignment());
             } else {
-                data = (T*)allocator.alloc(allocated * sizeof(T));
+                // @NOTE(CHall): realloc would move the bytes behind our back
+                T* new_data = (T*)allocator.alloc_aligned(allocated * sizeof(T), get_alignment());
+                ch::relocate(new_data, data, count);
+                allocator.free_sized(data, old_allocated * sizeof(T), get_alignment());
+                data = new_data;
             }
         }
 
@@ -127,6 +190,21 @@ namespace ch {
             return old_count;
         }
 
+        usize push(T&& t) {
+            const usize old_count = count;
+            insert(ch::move(t), count);
+            return old_count;
+        }
+
+        /** Constructs the new element in place from args */
+        template <typename... Args>
+        T& emplace(Args&&... args) {
+            T* result = make_room(count);
+            new (result) T(ch::forward<Args>(args)...);
+            count += 1;
+            return *result;
+        }
+
         usize push_empty() {
             const usize old_count = count;
             insert_zero(count);
@@ -139,37 +217,115 @@ namespace ch {
 
         void remove(usize index) {
             assert(index < count);
-            ch::mem_move(data + index, data + index + 1, (count - index) * sizeof(T));
+            ch::relocate(data + index, data + index + 1, count - index - 1);
             count -= 1;
         }
 
         void insert(const T& t, usize index) {
-            if (count == allocated) {
-                reserve(1);
+            // @NOTE(CHall): t could be one of our own elements so it has to be copied before anything moves
+            if (&t >= data && &t < data + count) {
+                T temp(t);
+                new (make_room(index)) T(ch::move(temp));
+            } else {
+                new (make_room(index)) T(t);
             }
+            count += 1;
+        }
 
-            if (index != count) {
-                ch::mem_move(data + index + 1, data + index, (count - index) * sizeof(T));
+        void insert(T&& t, usize index) {
+            if (&t >= data && &t < data + count) {
+                T temp(ch::move(t));
+                new (make_room(index)) T(ch::move(temp));
+            } else {
+                new (make_room(index)) T(ch::move(t));
             }
-
-            data[index] = t;
             count += 1;
         }
 
         void insert_zero(usize index) {
-            if (count == allocated) {
-                reserve(1);
+            ch::mem_zero(make_room(index), sizeof(T));
+            count += 1;
+        }
+
+        /** Appends num items with at most one grow. items can't point into the array */
+        usize push_range(const T* items, usize num) {
+            const usize old_count = count;
+            insert_range(items, num, count);
+            return old_count;
+        }
+
+        /** Inserts num items before index with one shift of the tail. items can't point into the array */
+        void insert_range(const T* items, usize num, usize index) {
+            assert(items + num <= data || items >= data + allocated);
+            if (!num) return;
+
+            T* dest = make_room(index, num);
+            if (ch::is_trivially_copyable<T>::value) {
+                ch::mem_copy(dest, items, num * sizeof(T));
+            } else {
+                for (usize i = 0; i < num; i++) {
+                    new (dest + i) T(items[i]);
+                }
             }
+            count += num;
+        }
+
+        /** Removes num elements starting at index with one shift of the tail */
+        void remove_range(usize index, usize num) {
+            assert(index + num <= count);
+            ch::relocate(data + index, data + index + num, count - index - num);
+            count -= num;
+        }
 
-            if (index != count) {
-                ch::mem_move(data + index + 1, data + index, (count - index) * sizeof(T));
+        /** O(1) remove that moves the last element into index instead of shifting. Doesn't keep the order */
+        void remove_swap(usize index) {
+            assert(index < count);
+            count -= 1;
+            if (index != count) ch::relocate(data + index, data + count, 1);
+        }
+
+        /**
+         * Removes every element pred returns true for in one pass, keeping the order of the rest
+         *
+         * @returns how many were removed
+         */
+        template <typename Predicate>
+        usize remove_if(Predicate pred) {
+            usize kept = 0;
+            for (usize i = 0; i < count; i++) {
+                if (pred(data[i])) continue;
+
+                if (kept != i) {
+                    if (ch::is_trivially_copyable<T>::value) {
+                        data[kept] = data[i];
+                    } else {
+                        ch::relocate(data + kept, data + i, 1);
+                    }
+                }
+                kept += 1;
             }
 
-            ch::mem_zero(data + index, sizeof(T));
-            count += 1;
+            const usize removed = count - kept;
+            count = kept;
+            return removed;
+        }
+
+        /** Grows if it has to and shifts everything from index on up by num. count is left alone */
+        T* make_room(usize index, usize num = 1) {
+            assert(index <= count);
+            if (count + num > allocated) {
+                reserve(count + num - allocated);
+            }
+
+            ch::relocate(data + index + num, data + index, count - index);
+            return data + index;
         }
 
         ssize find(const T& t) const {
+            if (ch::is_bitwise_comparable<T>::value && sizeof(T) == 1) {
+                return ch::mem_find_byte(data, count, *(const u8*)&t);
+            }
+
             for(usize i = 0; i < count; i++) {
                 if (data[i] == t) {
                     return i;
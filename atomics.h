@@ -0,0 +1,181 @@
+#pragma once
+
+#include "types.h"
+#include "thread.h"
+
+#if CH_COMPILER_MSVC
+#include <intrin.h>
+#endif
+
+/**
+ * Thin wrappers around the compiler atomics
+ *
+ * Loads are acquire, stores are release and all the read-modify-write ops are full barriers.
+ */
+namespace ch {
+	CH_FORCEINLINE u32 atomic_load(const volatile u32* ptr) {
+#if CH_COMPILER_MSVC
+		const u32 result = *ptr;
+		_ReadWriteBarrier();
+		return result;
+#else
+		return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+	}
+
+	CH_FORCEINLINE u64 atomic_load(const volatile u64* ptr) {
+#if CH_COMPILER_MSVC
+		const u64 result = *ptr;
+		_ReadWriteBarrier();
+		return result;
+#else
+		return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+	}
+
+	template <typename T>
+	CH_FORCEINLINE T* atomic_load(T* const volatile* ptr) {
+#if CH_COMPILER_MSVC
+		T* result = *ptr;
+		_ReadWriteBarrier();
+		return result;
+#else
+		return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+	}
+
+	CH_FORCEINLINE void atomic_store(volatile u32* ptr, u32 value) {
+#if CH_COMPILER_MSVC
+		_ReadWriteBarrier();
+		*ptr = value;
+#else
+		__atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+#endif
+	}
+
+	CH_FORCEINLINE void atomic_store(volatile u64* ptr, u64 value) {
+#if CH_COMPILER_MSVC
+		_ReadWriteBarrier();
+		*ptr = value;
+#else
+		__atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+#endif
+	}
+
+	template <typename T>
+	CH_FORCEINLINE void atomic_store(T* volatile* ptr, T* value) {
+#if CH_COMPILER_MSVC
+		_ReadWriteBarrier();
+		*ptr = value;
+#else
+		__atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+#endif
+	}
+
+	/** @returns the value before the add */
+	CH_FORCEINLINE u32 atomic_fetch_add(volatile u32* ptr, u32 value) {
+#if CH_COMPILER_MSVC
+		return (u32)_InterlockedExchangeAdd((volatile long*)ptr, (long)value);
+#else
+		return __atomic_fetch_add(ptr, value, __ATOMIC_SEQ_CST);
+#endif
+	}
+
+	CH_FORCEINLINE u64 atomic_fetch_add(volatile u64* ptr, u64 value) {
+#if CH_COMPILER_MSVC
+		return (u64)_InterlockedExchangeAdd64((volatile __int64*)ptr, (__int64)value);
+#else
+		return __atomic_fetch_add(ptr, value, __ATOMIC_SEQ_CST);
+#endif
+	}
+
+	CH_FORCEINLINE u32 atomic_exchange(volatile u32* ptr, u32 value) {
+#if CH_COMPILER_MSVC
+		return (u32)_InterlockedExchange((volatile long*)ptr, (long)value);
+#else
+		return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+#endif
+	}
+
+	CH_FORCEINLINE u64 atomic_exchange(volatile u64* ptr, u64 value) {
+#if CH_COMPILER_MSVC
+		return (u64)_InterlockedExchange64((volatile __int64*)ptr, (__int64)value);
+#else
+		return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+#endif
+	}
+
+	template <typename T>
+	CH_FORCEINLINE T* atomic_exchange(T* volatile* ptr, T* value) {
+#if CH_COMPILER_MSVC
+		return (T*)_InterlockedExchangePointer((void* volatile*)ptr, value);
+#else
+		return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+#endif
+	}
+
+	/** @returns true if ptr held expected and now holds desired */
+	CH_FORCEINLINE bool atomic_compare_exchange(volatile u32* ptr, u32 expected, u32 desired) {
+#if CH_COMPILER_MSVC
+		return (u32)_InterlockedCompareExchange((volatile long*)ptr, (long)desired, (long)expected) == expected;
+#else
+		return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+	}
+
+	CH_FORCEINLINE bool atomic_compare_exchange(volatile u64* ptr, u64 expected, u64 desired) {
+#if CH_COMPILER_MSVC
+		return (u64)_InterlockedCompareExchange64((volatile __int64*)ptr, (__int64)desired, (__int64)expected) == expected;
+#else
+		return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+	}
+
+	template <typename T>
+	CH_FORCEINLINE bool atomic_compare_exchange(T* volatile* ptr, T* expected, T* desired) {
+#if CH_COMPILER_MSVC
+		return _InterlockedCompareExchangePointer((void* volatile*)ptr, desired, expected) == expected;
+#else
+		return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+	}
+
+	/** Tells the cpu we're spinning so it can back off the other hyperthread */
+	CH_FORCEINLINE void cpu_relax() {
+#if CH_COMPILER_MSVC
+		_mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#endif
+	}
+
+	/** Only meant for short critical sections. There is no fairness and no sleeping */
+	struct Spin_Lock {
+		volatile u32 locked = 0;
+
+		CH_FORCEINLINE bool try_lock() {
+			return ch::atomic_load(&locked) == 0 && ch::atomic_exchange(&locked, 1) == 0;
+		}
+
+		CH_FORCEINLINE void lock() {
+			while (!try_lock()) {
+				ch::cpu_relax();
+			}
+		}
+
+		/** For locks held across more work. Whoever holds it might not be running so past a few spins we give up our time slice */
+		void lock_or_yield() {
+			for (u32 spins = 0; !try_lock(); spins++) {
+				if (spins < 64) {
+					ch::cpu_relax();
+				} else {
+					ch::yield_thread();
+				}
+			}
+		}
+
+		CH_FORCEINLINE void unlock() {
+			ch::atomic_store(&locked, 0);
+		}
+	};
+}
@@ -0,0 +1,814 @@
+/**
+ * ch_stl benchmarks
+ *
+ * Run with no arguments to run everything or pass the names of the benchmarks to run
+*/
+
+#include "ch_bench.h"
+
+#include "../memory.h"
+#include "../allocator.h"
+#include "../heap_profiler.h"
+#include "../free_list_allocator.h"
+#include "../pool_allocator.h"
+#include "../thread_cache_allocator.h"
+#include "../small_array.h"
+#include "../sort.h"
+#include "../parallel_sort.h"
+#include "../thread.h"
+#include "../atomics.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+static const usize mem_sizes[] = { 8, 64, 512, 4 * 1024, 32 * 1024, 256 * 1024, 2 * 1024 * 1024, 16 * 1024 * 1024, 64 * 1024 * 1024 };
+static const usize mem_max_size = 64 * 1024 * 1024;
+
+static usize get_iterations(usize size) {
+	const usize bytes_per_run = 1024ull * 1024 * 1024;
+	usize result = bytes_per_run / size;
+	if (result < 8) result = 8;
+	if (result > (1 << 22)) result = 1 << 22;
+	return result;
+}
+
+static void mem_bench() {
+	u8* src = (u8*)ch_malloc(mem_max_size + 64);
+	u8* dest = (u8*)ch_malloc(mem_max_size + 64);
+	defer(ch_free(src));
+	defer(ch_free(dest));
+	ch::mem_set(src, mem_max_size + 64, 0x5a);
+	ch::mem_set(dest, mem_max_size + 64, 0xa5);
+
+	const ch::Mem_Kernel_Type default_kernel = ch::get_mem_kernel_type();
+	defer(ch::set_mem_kernel_type(default_kernel));
+
+	printf("%-10s %-8s %12s %12s %12s\n", "size", "kernel", "copy GB/s", "move GB/s", "set GB/s");
+
+	for (usize size : mem_sizes) {
+		for (u32 kernel = ch::MKT_Scalar; kernel <= ch::MKT_AVX2; kernel += 1) {
+			if (!ch::set_mem_kernel_type((ch::Mem_Kernel_Type)kernel)) continue;
+
+			const usize iterations = get_iterations(size);
+			const f64 bytes = (f64)size * (f64)iterations;
+
+			f64 start = bench_now();
+			for (usize i = 0; i < iterations; i++) {
+				ch::mem_copy(dest, src, size);
+				bench_clobber(dest);
+			}
+			const f64 copy_time = bench_now() - start;
+
+			// Overlapping shift by one byte so the backward kernel gets exercised
+			start = bench_now();
+			for (usize i = 0; i < iterations; i++) {
+				ch::mem_move(src + 1, src, size);
+				bench_clobber(src);
+			}
+			const f64 move_time = bench_now() - start;
+
+			start = bench_now();
+			for (usize i = 0; i < iterations; i++) {
+				ch::mem_set(dest, size, (u8)i);
+				bench_clobber(dest);
+			}
+			const f64 set_time = bench_now() - start;
+
+			char size_string[32];
+			bench_format_bytes(size, size_string);
+			printf("%-10s %-8s %12.2f %12.2f %12.2f\n", size_string, ch::get_mem_kernel_name((ch::Mem_Kernel_Type)kernel),
+				bytes / copy_time / 1e9, bytes / move_time / 1e9, bytes / set_time / 1e9);
+		}
+	}
+}
+
+static void mem_search_bench() {
+	u8* a = (u8*)ch_malloc(mem_max_size);
+	u8* b = (u8*)ch_malloc(mem_max_size);
+	defer(ch_free(a));
+	defer(ch_free(b));
+	ch::mem_set(a, mem_max_size, 0x5a);
+	ch::mem_set(b, mem_max_size, 0x5a);
+
+	const ch::Mem_Kernel_Type default_kernel = ch::get_mem_kernel_type();
+	defer(ch::set_mem_kernel_type(default_kernel));
+
+	printf("%-10s %-8s %12s %12s\n", "size", "kernel", "compare GB/s", "find GB/s");
+
+	for (usize size : mem_sizes) {
+		for (u32 kernel = ch::MKT_Scalar; kernel <= ch::MKT_AVX2; kernel += 1) {
+			if (!ch::set_mem_kernel_type((ch::Mem_Kernel_Type)kernel)) continue;
+
+			const usize iterations = get_iterations(size);
+			const f64 bytes = (f64)size * (f64)iterations;
+
+			// Both worst cases. The buffers are equal and the byte being searched for isn't there
+			s64 sink = 0;
+			f64 start = bench_now();
+			for (usize i = 0; i < iterations; i++) {
+				sink += ch::mem_compare(a, b, size);
+				bench_clobber(a);
+			}
+			const f64 compare_time = bench_now() - start;
+
+			start = bench_now();
+			for (usize i = 0; i < iterations; i++) {
+				sink += ch::mem_find_byte(a, size, 0);
+				bench_clobber(a);
+			}
+			const f64 find_time = bench_now() - start;
+			bench_clobber(&sink);
+
+			char size_string[32];
+			bench_format_bytes(size, size_string);
+			printf("%-10s %-8s %12.2f %12.2f\n", size_string, ch::get_mem_kernel_name((ch::Mem_Kernel_Type)kernel),
+				bytes / compare_time / 1e9, bytes / find_time / 1e9);
+		}
+	}
+}
+
+static f64 touch_working_set(u8* data, usize size) {
+	const f64 start = bench_now();
+	u64 sum = 0;
+	for (usize i = 0; i < size; i += 64) {
+		sum += data[i];
+	}
+	bench_clobber(&sum);
+	return bench_now() - start;
+}
+
+/**
+ * Copies a large buffer with and without streaming stores and then measures how long it takes to walk a small working
+ * set that was hot before the copy. The closer the "after" time is to the "hot" time the less the copy polluted the cache.
+ */
+static void mem_streaming_bench() {
+	u8* src = (u8*)ch_malloc(mem_max_size);
+	u8* dest = (u8*)ch_malloc(mem_max_size);
+	defer(ch_free(src));
+	defer(ch_free(dest));
+	ch::mem_set(src, mem_max_size, 0x5a);
+	ch::mem_set(dest, mem_max_size, 0xa5);
+
+	const usize working_set_size = 512 * 1024;
+	u8* working_set = (u8*)ch_malloc(working_set_size);
+	defer(ch_free(working_set));
+	ch::mem_set(working_set, working_set_size, 1);
+
+	const usize default_threshold = ch::get_mem_streaming_threshold();
+	defer(ch::set_mem_streaming_threshold(default_threshold));
+
+	printf("%-10s %-10s %12s %14s %14s\n", "size", "mode", "copy GB/s", "hot set us", "after copy us");
+
+	for (usize size = 1024 * 1024; size <= mem_max_size; size *= 4) {
+		for (u32 streaming = 0; streaming < 2; streaming += 1) {
+			ch::set_mem_streaming_threshold(streaming ? 0 : U64_MAX);
+
+			const usize iterations = get_iterations(size);
+			f64 copy_time = 0.0;
+			f64 hot_time = 0.0;
+			f64 after_time = 0.0;
+			for (usize i = 0; i < iterations; i++) {
+				touch_working_set(working_set, working_set_size);
+				hot_time += touch_working_set(working_set, working_set_size);
+
+				const f64 start = bench_now();
+				ch::mem_copy(dest, src, size);
+				bench_clobber(dest);
+				copy_time += bench_now() - start;
+
+				after_time += touch_working_set(working_set, working_set_size);
+			}
+
+			char size_string[32];
+			bench_format_bytes(size, size_string);
+			printf("%-10s %-10s %12.2f %14.2f %14.2f\n", size_string, streaming ? "streaming" : "regular",
+				(f64)size * iterations / copy_time / 1e9, hot_time / iterations * 1e6, after_time / iterations * 1e6);
+		}
+	}
+
+	printf("default streaming threshold: %llu bytes\n", (unsigned long long)default_threshold);
+}
+
+/** Mixed sizes with a rolling window of live allocations so frees land on sampled pointers some of the time */
+static f64 heap_churn(usize iterations) {
+	const usize window_size = 4096;
+	void* window[window_size] = {};
+	u64 rng = 0x2545f4914f6cdd1dull;
+
+	const f64 start = bench_now();
+	for (usize i = 0; i < iterations; i++) {
+		rng ^= rng << 13;
+		rng ^= rng >> 7;
+		rng ^= rng << 17;
+
+		const usize index = i & (window_size - 1);
+		ch::free(window[index]);
+
+		// Mostly small with the occasional big one like a real program
+		usize size = 16 + (rng & 255);
+		if ((rng >> 32) % 64 == 0) size = 4096 + ((rng >> 8) & 0xffff);
+		window[index] = ch::malloc(size);
+		bench_clobber(window[index]);
+	}
+	const f64 result = bench_now() - start;
+
+	for (void* it : window) {
+		ch::free(it);
+	}
+	return result;
+}
+
+static void heap_profiler_bench() {
+	const usize iterations = 1024 * 1024;
+	const usize runs = 8;
+	const usize num_intervals = 3;
+	const usize intervals[num_intervals] = { 64 * 1024, 512 * 1024, 4 * 1024 * 1024 };
+
+	// Best of a few runs each, interleaved so drift in the machine hits both sides the same
+	heap_churn(iterations);
+	f64 off_time = 1e30;
+	f64 on_times[num_intervals];
+	for (f64& it : on_times) it = 1e30;
+
+	for (usize run = 0; run < runs; run++) {
+		const f64 time = heap_churn(iterations);
+		if (time < off_time) off_time = time;
+
+		for (usize i = 0; i < num_intervals; i++) {
+			ch::start_heap_profiler(intervals[i]);
+			const f64 on_time = heap_churn(iterations);
+			if (on_time < on_times[i]) on_times[i] = on_time;
+
+			ch::Heap_Profile_Snapshot snapshot = ch::take_heap_profile_snapshot();
+			snapshot.free();
+			ch::stop_heap_profiler();
+		}
+	}
+
+	printf("%-14s %12s %10s\n", "interval", "ns/op", "overhead");
+	printf("%-14s %12.2f %10s\n", "off", off_time / iterations * 1e9, "-");
+
+	for (usize i = 0; i < num_intervals; i++) {
+		char interval_string[32];
+		bench_format_bytes(intervals[i], interval_string);
+		printf("%-14s %12.2f %9.2f%%\n", interval_string, on_times[i] / iterations * 1e9, (on_times[i] / off_time - 1.0) * 100.0);
+	}
+}
+
+/** Same churn as heap_churn but through an allocator and with the blocks touched so locality shows up */
+static f64 allocator_churn(ch::Allocator allocator, usize iterations) {
+	const usize window_size = 4096;
+	void* window[window_size] = {};
+	u64 rng = 0x2545f4914f6cdd1dull;
+	u64 sum = 0;
+
+	const f64 start = bench_now();
+	for (usize i = 0; i < iterations; i++) {
+		rng ^= rng << 13;
+		rng ^= rng >> 7;
+		rng ^= rng << 17;
+
+		const usize index = (usize)(rng >> 20) & (window_size - 1);
+		if (window[index]) {
+			sum += *(u8*)window[index];
+			allocator.free(window[index]);
+		}
+
+		usize size = 16 + (rng & 255);
+		if ((rng >> 32) % 64 == 0) size = 4096 + ((rng >> 8) & 0xffff);
+		window[index] = allocator.alloc(size);
+		ch::mem_set(window[index], size < 64 ? size : 64, (u8)i);
+	}
+	const f64 result = bench_now() - start;
+	bench_clobber(&sum);
+
+	for (void* it : window) {
+		if (it) allocator.free(it);
+	}
+	return result;
+}
+
+static void free_list_bench() {
+	const usize iterations = 4 * 1024 * 1024;
+
+	const f64 heap_time = allocator_churn(ch::get_heap_allocator(), iterations);
+
+	ch::Allocator free_list = ch::make_free_list_allocator();
+	const f64 free_list_time = allocator_churn(free_list, iterations);
+	const usize num_chunks = free_list.get_header<ch::Free_List_Allocator_Header>()->num_chunks;
+	ch::free_free_list_allocator(&free_list);
+
+	printf("%-12s %12s\n", "allocator", "ns/op");
+	printf("%-12s %12.2f\n", "heap", heap_time / iterations * 1e9);
+	printf("%-12s %12.2f  (%llu chunks)\n", "free list", free_list_time / iterations * 1e9, (unsigned long long)num_chunks);
+}
+
+/** Node sized churn with a fixed number of live objects like a tree or a linked list would see */
+static f64 node_churn(ch::Allocator allocator, usize node_size, usize num_live, usize iterations) {
+	void** live = (void**)ch::os_malloc(num_live * sizeof(void*));
+	for (usize i = 0; i < num_live; i++) {
+		live[i] = allocator.alloc(node_size);
+	}
+
+	u64 rng = 0x2545f4914f6cdd1dull;
+	const f64 start = bench_now();
+	for (usize i = 0; i < iterations; i++) {
+		rng ^= rng << 13;
+		rng ^= rng >> 7;
+		rng ^= rng << 17;
+
+		const usize index = (usize)(rng % num_live);
+		allocator.free(live[index]);
+		live[index] = allocator.alloc(node_size);
+		*(u8*)live[index] = (u8)i;
+	}
+	const f64 result = bench_now() - start;
+
+	for (usize i = 0; i < num_live; i++) {
+		allocator.free(live[i]);
+	}
+	ch::os_free(live);
+	return result;
+}
+
+static void object_pool_bench() {
+	const usize node_size = 32;
+	const usize num_live_counts = 3;
+	const usize live_counts[num_live_counts] = { 256, 4096, 65536 };
+
+	printf("%-10s %12s %12s\n", "live", "pool ns/op", "object ns/op");
+	for (usize num_live : live_counts) {
+		// The old pool does a linear scan so it gets fewer iterations to keep the run short
+		const usize pool_iterations = 1024 * 1024 * 16 / num_live;
+		const usize object_iterations = 4 * 1024 * 1024;
+
+		ch::Allocator pool = ch::make_pool_allocator(node_size, num_live);
+		const f64 pool_time = node_churn(pool, node_size, num_live, pool_iterations);
+		ch::free_pool_allocator(&pool);
+
+		ch::Allocator objects = ch::make_object_pool_allocator(node_size, 1024);
+		const f64 object_time = node_churn(objects, node_size, num_live, object_iterations);
+		ch::free_object_pool_allocator(&objects);
+
+		printf("%-10llu %12.2f %12.2f\n", (unsigned long long)num_live, pool_time / pool_iterations * 1e9, object_time / object_iterations * 1e9);
+	}
+}
+
+/** Runs of 1 to 8 buckets replaced at random in a pool that's kept about half full so free runs are scattered */
+static void pool_bench() {
+	const usize bucket_size = 16;
+	const usize num_bucket_counts = 3;
+	const usize bucket_counts[num_bucket_counts] = { 1024, 16 * 1024, 128 * 1024 };
+	const usize iterations = 1024 * 1024;
+
+	printf("%-10s %12s %12s\n", "buckets", "ns/op", "failed");
+	for (usize num_buckets : bucket_counts) {
+		ch::Allocator pool = ch::make_pool_allocator(bucket_size, num_buckets);
+
+		// Averages 4.5 buckets a run so this many live keeps it about half full
+		const usize num_live = num_buckets / 9;
+		void** live = (void**)ch::os_malloc(num_live * sizeof(void*));
+		u64 rng = 0x2545f4914f6cdd1dull;
+		auto next_size = [&]() {
+			rng ^= rng << 13;
+			rng ^= rng >> 7;
+			rng ^= rng << 17;
+			return bucket_size * (1 + (rng & 7));
+		};
+
+		for (usize i = 0; i < num_live; i++) {
+			live[i] = pool.alloc(next_size());
+		}
+
+		usize num_failed = 0;
+		const f64 start = bench_now();
+		for (usize i = 0; i < iterations; i++) {
+			const usize index = (usize)((rng >> 32) % num_live);
+			pool.free(live[index]);
+			live[index] = pool.alloc(next_size());
+			if (!live[index]) num_failed += 1;
+		}
+		const f64 time = bench_now() - start;
+
+		ch::os_free(live);
+		ch::free_pool_allocator(&pool);
+		printf("%-10llu %12.2f %12llu\n", (unsigned long long)num_buckets, time / iterations * 1e9, (unsigned long long)num_failed);
+	}
+}
+
+struct Threaded_Churn {
+	void* (*malloc_func)(usize size);
+	void (*free_func)(void* ptr);
+	usize iterations;
+	u64 seed;
+
+	/** Slots shared with the next thread in the ring so some frees land on a different thread than the alloc */
+	void* volatile* next_handoff;
+};
+
+const usize threaded_window_size = 1024;
+const usize threaded_handoff_size = 256;
+
+static void threaded_churn(void* param) {
+	Threaded_Churn& churn = *(Threaded_Churn*)param;
+	void* window[threaded_window_size] = {};
+	u64 rng = churn.seed;
+
+	for (usize i = 0; i < churn.iterations; i++) {
+		rng ^= rng << 13;
+		rng ^= rng >> 7;
+		rng ^= rng << 17;
+
+		const usize index = (usize)(rng >> 20) & (threaded_window_size - 1);
+		void* old = window[index];
+
+		// One in 8 goes to the next thread instead of being freed here
+		if (old && (rng >> 40) % 8 == 0) {
+			const usize slot = (usize)(rng >> 48) & (threaded_handoff_size - 1);
+			old = ch::atomic_exchange(&churn.next_handoff[slot], old);
+		}
+		churn.free_func(old);
+
+		usize size = 16 + (rng & 255);
+		if ((rng >> 32) % 64 == 0) size = 1024 + ((rng >> 8) & 0x3fff);
+		window[index] = churn.malloc_func(size);
+		*(u8*)window[index] = (u8)i;
+	}
+
+	for (void* it : window) {
+		churn.free_func(it);
+	}
+}
+
+static void libc_free(void* ptr) {
+	::free(ptr);
+}
+
+static void* libc_malloc(usize size) {
+	return ::malloc(size);
+}
+
+static f64 run_threaded_churn(void* (*malloc_func)(usize), void (*free_func)(void*), u32 num_threads, usize iterations) {
+	const u32 max_threads = 16;
+	assert(num_threads <= max_threads);
+
+	static void* volatile handoffs[max_threads][threaded_handoff_size];
+	Threaded_Churn churns[max_threads];
+	ch::Thread threads[max_threads];
+
+	for (u32 i = 0; i < num_threads; i++) {
+		Threaded_Churn& it = churns[i];
+		it.malloc_func = malloc_func;
+		it.free_func = free_func;
+		it.iterations = iterations;
+		it.seed = 0x2545f4914f6cdd1dull * (i + 1);
+		it.next_handoff = handoffs[(i + 1) % num_threads];
+	}
+
+	const f64 start = bench_now();
+	for (u32 i = 0; i < num_threads; i++) {
+		ch::create_thread(threaded_churn, &churns[i], &threads[i]);
+	}
+	for (u32 i = 0; i < num_threads; i++) {
+		ch::join_thread(&threads[i]);
+	}
+	const f64 result = bench_now() - start;
+
+	for (u32 i = 0; i < num_threads; i++) {
+		for (void* volatile& it : handoffs[i]) {
+			free_func(it);
+			it = nullptr;
+		}
+	}
+	return result;
+}
+
+static void thread_cache_bench() {
+	const usize iterations = 1024 * 1024;
+	const usize runs = 4;
+	const u32 num_thread_counts = 4;
+	const u32 thread_counts[num_thread_counts] = { 1, 2, 4, 8 };
+
+	printf("%u cores\n", ch::get_num_cpu_cores());
+	printf("%-8s %14s %14s %10s\n", "threads", "libc Mops/s", "cache Mops/s", "speedup");
+
+	for (u32 num_threads : thread_counts) {
+		f64 libc_time = 1e30;
+		f64 cache_time = 1e30;
+		for (usize run = 0; run < runs; run++) {
+			const f64 a = run_threaded_churn(libc_malloc, libc_free, num_threads, iterations);
+			if (a < libc_time) libc_time = a;
+
+			const f64 b = run_threaded_churn(ch::thread_cache_malloc, ch::thread_cache_free, num_threads, iterations);
+			if (b < cache_time) cache_time = b;
+		}
+
+		const f64 ops = (f64)iterations * num_threads / 1e6;
+		printf("%-8u %14.2f %14.2f %9.2fx\n", num_threads, ops / libc_time, ops / cache_time, libc_time / cache_time);
+	}
+}
+
+/** Short lived lists of a few elements each. Every fourth one holds more than fits inline */
+template <typename List>
+static f64 short_list_churn(usize iterations) {
+	const f64 start = bench_now();
+	for (usize i = 0; i < iterations; i++) {
+		List list;
+		const u32 num_elements = (i & 3) ? 6 : 24;
+		for (u32 j = 0; j < num_elements; j++) {
+			list.push(j);
+		}
+		bench_clobber(list.data);
+		list.free();
+	}
+	return bench_now() - start;
+}
+
+static void small_array_bench() {
+	const usize iterations = 1024 * 1024;
+	const usize runs = 4;
+
+	f64 array_time = 1e30;
+	f64 small_time = 1e30;
+	for (usize run = 0; run < runs; run++) {
+		const f64 a = short_list_churn<ch::Array<u32>>(iterations);
+		if (a < array_time) array_time = a;
+
+		const f64 b = short_list_churn<ch::Small_Array<u32, 8>>(iterations);
+		if (b < small_time) small_time = b;
+	}
+
+	printf("%-12s %12s\n", "container", "ns per list");
+	printf("%-12s %12.2f\n", "Array", array_time / iterations * 1e9);
+	printf("%-12s %12.2f\n", "Small_Array", small_time / iterations * 1e9);
+}
+
+static void array_range_bench() {
+	const usize num_items = 64 * 1024;
+	const usize runs = 4;
+	u32* items = (u32*)ch::os_malloc(num_items * sizeof(u32));
+	defer(ch::os_free(items));
+	for (usize i = 0; i < num_items; i++) items[i] = (u32)i;
+
+	f64 push_time = 1e30;
+	f64 push_range_time = 1e30;
+	f64 remove_time = 1e30;
+	f64 remove_if_time = 1e30;
+	for (usize run = 0; run < runs; run++) {
+		ch::Array<u32> a;
+		f64 start = bench_now();
+		for (usize i = 0; i < num_items; i++) a.push(items[i]);
+		f64 time = bench_now() - start;
+		if (time < push_time) push_time = time;
+
+		ch::Array<u32> b;
+		start = bench_now();
+		b.push_range(items, num_items);
+		time = bench_now() - start;
+		if (time < push_range_time) push_range_time = time;
+
+		// Drop every odd number
+		start = bench_now();
+		for (usize i = 1; i < a.count; i++) a.remove(i);
+		time = bench_now() - start;
+		if (time < remove_time) remove_time = time;
+
+		start = bench_now();
+		b.remove_if([](u32 it) { return (it & 1) != 0; });
+		time = bench_now() - start;
+		if (time < remove_if_time) remove_if_time = time;
+
+		bench_clobber(a.data);
+		bench_clobber(b.data);
+		a.free();
+		b.free();
+	}
+
+	printf("%-20s %12s\n", "64k u32s", "us");
+	printf("%-20s %12.2f\n", "push", push_time * 1e6);
+	printf("%-20s %12.2f\n", "push_range", push_range_time * 1e6);
+	printf("%-20s %12.2f\n", "remove every other", remove_time * 1e6);
+	printf("%-20s %12.2f\n", "remove_if", remove_if_time * 1e6);
+}
+
+/** Random u32s. The input gets copied back in before every run so every sort sees the same data */
+static void sort_bench() {
+	const usize num_sizes = 3;
+	const usize sizes[num_sizes] = { 1024 * 1024, 10 * 1024 * 1024, 100 * 1024 * 1024 };
+	const usize max_size = sizes[num_sizes - 1];
+
+	u32* input = (u32*)ch::os_malloc(max_size * sizeof(u32));
+	u32* items = (u32*)ch::os_malloc(max_size * sizeof(u32));
+	defer(ch::os_free(input));
+	defer(ch::os_free(items));
+
+	u64 rng = 0x2545f4914f6cdd1dull;
+	for (usize i = 0; i < max_size; i++) {
+		rng ^= rng << 13;
+		rng ^= rng >> 7;
+		rng ^= rng << 17;
+		input[i] = (u32)rng;
+	}
+
+	const ch::Allocator heap = ch::get_heap_allocator();
+	printf("%-10s %12s %12s %12s %12s\n", "count", "std::sort", "ch::sort", "stable_sort", "radix_sort");
+	for (usize size : sizes) {
+		// One run of 100M already takes seconds
+		const usize runs = size > 10 * 1024 * 1024 ? 1 : 3;
+		f64 times[4] = { 1e30, 1e30, 1e30, 1e30 };
+		for (usize run = 0; run < runs; run++) {
+			for (usize kind = 0; kind < 4; kind++) {
+				ch::mem_copy(items, input, size * sizeof(u32));
+
+				const f64 start = bench_now();
+				switch (kind) {
+				case 0: std::sort(items, items + size); break;
+				case 1: ch::sort(items, size); break;
+				case 2: ch::stable_sort(items, size, heap); break;
+				case 3: ch::radix_sort(items, size, heap); break;
+				}
+				const f64 time = bench_now() - start;
+				bench_clobber(items);
+				if (time < times[kind]) times[kind] = time;
+			}
+		}
+
+		printf("%-10llu %10.1fms %10.1fms %10.1fms %10.1fms\n", (unsigned long long)size, times[0] * 1e3, times[1] * 1e3, times[2] * 1e3, times[3] * 1e3);
+	}
+}
+
+/**
+ * Same data as sort_bench with 1, 2, 4... workers up to the number of cores. One worker is just ch::sort and
+ * ch::radix_sort and the speedups are against that.
+ */
+static void parallel_sort_bench() {
+	const usize num_sizes = 3;
+	const usize sizes[num_sizes] = { 1024 * 1024, 10 * 1024 * 1024, 100 * 1024 * 1024 };
+	const usize max_size = sizes[num_sizes - 1];
+
+	u32* input = (u32*)ch::os_malloc(max_size * sizeof(u32));
+	u32* items = (u32*)ch::os_malloc(max_size * sizeof(u32));
+	defer(ch::os_free(input));
+	defer(ch::os_free(items));
+
+	u64 rng = 0x2545f4914f6cdd1dull;
+	for (usize i = 0; i < max_size; i++) {
+		rng ^= rng << 13;
+		rng ^= rng >> 7;
+		rng ^= rng << 17;
+		input[i] = (u32)rng;
+	}
+
+	const u32 max_worker_counts = 32;
+	u32 worker_counts[max_worker_counts];
+	u32 num_worker_counts = 0;
+	const u32 num_cores = ch::get_num_cpu_cores();
+
+	// @NOTE(CHall): Always goes up to 16 workers so runs on different machines line up. Past num_cores is oversubscribed.
+	const u32 max_workers = num_cores > 16 ? num_cores : 16;
+	for (u32 num_workers = 1; num_workers < max_workers && num_worker_counts < max_worker_counts - 1; num_workers *= 2) {
+		worker_counts[num_worker_counts++] = num_workers;
+	}
+	worker_counts[num_worker_counts++] = max_workers;
+
+	const ch::Allocator heap = ch::get_heap_allocator();
+	printf("%u cores\n", num_cores);
+	printf("%-10s %-8s %12s %8s %12s %8s\n", "count", "workers", "sample sort", "speedup", "radix sort", "speedup");
+	for (usize size : sizes) {
+		const usize runs = size > 10 * 1024 * 1024 ? 1 : 3;
+		f64 base_times[2] = {};
+
+		for (u32 worker_index = 0; worker_index < num_worker_counts; worker_index++) {
+			const u32 num_workers = worker_counts[worker_index];
+			ch::Thread_Pool pool = {};
+			if (num_workers > 1) ch::make_thread_pool(&pool, num_workers - 1);
+
+			f64 times[2] = { 1e30, 1e30 };
+			for (usize run = 0; run < runs; run++) {
+				for (usize kind = 0; kind < 2; kind++) {
+					ch::mem_copy(items, input, size * sizeof(u32));
+
+					const f64 start = bench_now();
+					if (num_workers == 1) {
+						if (kind == 0) ch::sort(items, size);
+						else ch::radix_sort(items, size, heap);
+					} else {
+						if (kind == 0) ch::parallel_sort(items, size, &pool, heap);
+						else ch::parallel_radix_sort(items, size, &pool, heap);
+					}
+					const f64 time = bench_now() - start;
+					bench_clobber(items);
+					if (time < times[kind]) times[kind] = time;
+				}
+			}
+
+			if (num_workers > 1) ch::free_thread_pool(&pool);
+			if (num_workers == 1) {
+				base_times[0] = times[0];
+				base_times[1] = times[1];
+			}
+
+			printf("%-10llu %-8u %10.1fms %7.2fx %10.1fms %7.2fx\n", (unsigned long long)size, num_workers, times[0] * 1e3, base_times[0] / times[0], times[1] * 1e3, base_times[1] / times[1]);
+		}
+	}
+}
+
+struct Arena_Fill {
+	ch::Allocator allocator;
+	ch::Spin_Lock* lock;
+	usize iterations;
+};
+
+/** Small allocations like a parser filling out nodes. A lock is only taken when one is passed */
+static void arena_fill(void* param) {
+	Arena_Fill& fill = *(Arena_Fill*)param;
+	for (usize i = 0; i < fill.iterations; i++) {
+		const usize size = 16 + (i * 7) % 112;
+		if (fill.lock) fill.lock->lock();
+		u8* result = (u8*)fill.allocator.alloc(size);
+		if (fill.lock) fill.lock->unlock();
+		*result = (u8)i;
+	}
+}
+
+static f64 run_arena_fill(ch::Allocator allocator, ch::Spin_Lock* lock, u32 num_threads, usize iterations) {
+	const u32 max_threads = 16;
+	assert(num_threads <= max_threads);
+
+	Arena_Fill fills[max_threads];
+	ch::Thread threads[max_threads];
+
+	const f64 start = bench_now();
+	for (u32 i = 0; i < num_threads; i++) {
+		fills[i] = { allocator, lock, iterations };
+		ch::create_thread(arena_fill, &fills[i], &threads[i]);
+	}
+	for (u32 i = 0; i < num_threads; i++) {
+		ch::join_thread(&threads[i]);
+	}
+	return bench_now() - start;
+}
+
+static void concurrent_arena_bench() {
+	const usize iterations = 1024 * 1024;
+	const usize runs = 4;
+	const usize reserve_size = 2048ull * 1024 * 1024;
+	const u32 num_thread_counts = 4;
+	const u32 thread_counts[num_thread_counts] = { 1, 2, 4, 8 };
+
+	ch::Allocator locked = ch::make_virtual_arena_allocator(reserve_size);
+	ch::Allocator concurrent = ch::make_concurrent_arena_allocator(reserve_size);
+	ch::Spin_Lock lock;
+
+	printf("%u cores\n", ch::get_num_cpu_cores());
+	printf("%-8s %14s %16s %10s\n", "threads", "locked Mops/s", "lock free Mops/s", "speedup");
+
+	for (u32 num_threads : thread_counts) {
+		f64 locked_time = 1e30;
+		f64 concurrent_time = 1e30;
+		for (usize run = 0; run < runs; run++) {
+			const f64 a = run_arena_fill(locked, &lock, num_threads, iterations);
+			if (a < locked_time) locked_time = a;
+			ch::reset_arena_allocator(&locked);
+
+			const f64 b = run_arena_fill(concurrent, nullptr, num_threads, iterations);
+			if (b < concurrent_time) concurrent_time = b;
+			ch::reset_concurrent_arena_allocator(&concurrent);
+		}
+
+		const f64 ops = (f64)iterations * num_threads / 1e6;
+		printf("%-8u %14.2f %16.2f %9.2fx\n", num_threads, ops / locked_time, ops / concurrent_time, locked_time / concurrent_time);
+	}
+
+	ch::free_arena_allocator(&locked);
+	ch::free_concurrent_arena_allocator(&concurrent);
+}
+
+static const Bench_Entry benches[] = {
+	{ "mem", mem_bench },
+	{ "mem_streaming", mem_streaming_bench },
+	{ "mem_search", mem_search_bench },
+	{ "heap_profiler", heap_profiler_bench },
+	{ "free_list", free_list_bench },
+	{ "pool", pool_bench },
+	{ "object_pool", object_pool_bench },
+	{ "thread_cache", thread_cache_bench },
+	{ "concurrent_arena", concurrent_arena_bench },
+	{ "small_array", small_array_bench },
+	{ "array_range", array_range_bench },
+	{ "sort", sort_bench },
+	{ "parallel_sort", parallel_sort_bench },
+};
+
+int main(int argc, char** argv) {
+	for (const Bench_Entry& it : benches) {
+		if (!bench_should_run(it.name, argc, argv)) continue;
+
+		printf("------- %s -------\n", it.name);
+		it.func();
+		printf("\n");
+	}
+
+	return 0;
+}
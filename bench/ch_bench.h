@@ -0,0 +1,46 @@
+#pragma once
+
+#include "../string.h"
+
+#include <chrono>
+#include <stdio.h>
+
+struct Bench_Entry {
+	const char* name;
+	void (*func)();
+};
+
+CH_FORCEINLINE f64 bench_now() {
+	using Clock = std::chrono::steady_clock;
+	return std::chrono::duration<f64>(Clock::now().time_since_epoch()).count();
+}
+
+/** Keeps the optimizer from throwing away work whose results are never read */
+CH_FORCEINLINE void bench_clobber(void* ptr) {
+#if CH_COMPILER_MSVC
+	static void* volatile sink;
+	sink = ptr;
+#else
+	__asm__ volatile("" : : "r"(ptr) : "memory");
+#endif
+}
+
+CH_FORCEINLINE void bench_format_bytes(usize bytes, char* out) {
+	if (bytes >= 1024 * 1024 && bytes % (1024 * 1024) == 0) {
+		sprintf(out, "%llumb", (unsigned long long)(bytes / (1024 * 1024)));
+	} else if (bytes >= 1024 && bytes % 1024 == 0) {
+		sprintf(out, "%llukb", (unsigned long long)(bytes / 1024));
+	} else {
+		sprintf(out, "%llub", (unsigned long long)bytes);
+	}
+}
+
+CH_FORCEINLINE bool bench_should_run(const char* name, int argc, char** argv) {
+	if (argc <= 1) return true;
+
+	for (int i = 1; i < argc; i++) {
+		if (ch::streq(argv[i], name)) return true;
+	}
+
+	return false;
+}
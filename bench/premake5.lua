@@ -0,0 +1,46 @@
+workspace "ch_stl_bench"
+	architecture "x64"
+	startproject "ch_bench"
+
+	configurations
+    {
+        "Debug",
+        "Release"
+    }
+
+	targetdir ("../bin")
+	objdir ("../bin")
+	debugdir ("../bin")
+	characterset ("ascii")
+
+include ".."
+
+project "ch_bench"
+	kind "ConsoleApp"
+    language "C++"
+
+	dependson 
+	{
+		"ch_stl"
+	}
+
+	files 
+	{
+		"*.h",
+		"*.cpp"
+	}
+
+	links
+	{
+		"ch_stl",
+	}
+
+	filter "system:linux"
+		links
+		{
+			"pthread",
+		}
+
+	filter {}
+
+	-- @NOTE(CHall): No includedirs on purpose. The lib has a string.h and time.h that would shadow the crt ones.
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "types.h"
+
+#if CH_COMPILER_MSVC
+#include <intrin.h>
+#endif
+
+namespace ch {
+	/** Undefined for 0 */
+	CH_FORCEINLINE u32 count_trailing_zeros(u32 x) {
+#if CH_COMPILER_MSVC
+		unsigned long result;
+		_BitScanForward(&result, x);
+		return (u32)result;
+#else
+		return (u32)__builtin_ctz(x);
+#endif
+	}
+
+	/** Undefined for 0 */
+	CH_FORCEINLINE u32 count_trailing_zeros(u64 x) {
+#if CH_COMPILER_MSVC
+		unsigned long result;
+		_BitScanForward64(&result, x);
+		return (u32)result;
+#else
+		return (u32)__builtin_ctzll(x);
+#endif
+	}
+
+	/** Undefined for 0 */
+	CH_FORCEINLINE u32 count_leading_zeros(u32 x) {
+#if CH_COMPILER_MSVC
+		unsigned long result;
+		_BitScanReverse(&result, x);
+		return 31 - (u32)result;
+#else
+		return (u32)__builtin_clz(x);
+#endif
+	}
+
+	/** Undefined for 0 */
+	CH_FORCEINLINE u32 count_leading_zeros(u64 x) {
+#if CH_COMPILER_MSVC
+		unsigned long result;
+		_BitScanReverse64(&result, x);
+		return 63 - (u32)result;
+#else
+		return (u32)__builtin_clzll(x);
+#endif
+	}
+
+	/** Index of the highest set bit. Undefined for 0 */
+	CH_FORCEINLINE u32 find_last_set(u32 x) {
+		return 31 - ch::count_leading_zeros(x);
+	}
+
+	CH_FORCEINLINE u32 find_last_set(u64 x) {
+		return 63 - ch::count_leading_zeros(x);
+	}
+
+	/** Smallest power of two that's at least x. 1 for 0 */
+	CH_FORCEINLINE u64 round_up_pow2(u64 x) {
+		return x <= 1 ? 1 : (u64)1 << (ch::find_last_set(x - 1) + 1);
+	}
+
+	CH_FORCEINLINE u32 count_set_bits(u32 x) {
+#if CH_COMPILER_MSVC
+		return (u32)__popcnt(x);
+#else
+		return (u32)__builtin_popcount(x);
+#endif
+	}
+
+	CH_FORCEINLINE u32 count_set_bits(u64 x) {
+#if CH_COMPILER_MSVC
+		return (u32)__popcnt64(x);
+#else
+		return (u32)__builtin_popcountll(x);
+#endif
+	}
+}
\ No newline at end of file
@@ -36,12 +36,7 @@ TODO
     - containers
         - set
     - multithreading
-        - thread
         - mutex
-        - semaphore
-    - allocators
-        - stack
-        - free list
 */
 
 #pragma once
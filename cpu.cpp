@@ -0,0 +1,66 @@
+#include "cpu.h"
+
+#if CH_CPU_X86
+#if CH_COMPILER_MSVC
+#include <intrin.h>
+
+static void cpuid(u32 leaf, u32 subleaf, u32* regs) {
+	__cpuidex((int*)regs, (int)leaf, (int)subleaf);
+}
+
+static u64 xgetbv(u32 index) {
+	return _xgetbv(index);
+}
+#else
+#include <cpuid.h>
+
+static void cpuid(u32 leaf, u32 subleaf, u32* regs) {
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+}
+
+static u64 xgetbv(u32 index) {
+	u32 eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
+	return ((u64)edx << 32) | eax;
+}
+#endif
+
+static u32 query_cpu_features() {
+	u32 result = 0;
+
+	u32 regs[4];
+	cpuid(0, 0, regs);
+	const u32 max_leaf = regs[0];
+
+	if (max_leaf >= 1) {
+		cpuid(1, 0, regs);
+		const u32 ecx = regs[2];
+		const u32 edx = regs[3];
+
+		if (edx & (1 << 26)) result |= ch::CF_SSE2;
+		if (ecx & (1 << 20)) result |= ch::CF_SSE4_2;
+		if (ecx & (1 << 23)) result |= ch::CF_POPCNT;
+
+		// @NOTE(CHall): The cpu supporting avx isn't enough. The OS has to save the ymm registers on a context switch too.
+		const bool os_saves_ymm = (ecx & (1 << 27)) && (xgetbv(0) & 0x6) == 0x6;
+		if (max_leaf >= 7) {
+			cpuid(7, 0, regs);
+			const u32 ebx = regs[1];
+
+			if ((ebx & (1 << 5)) && os_saves_ymm) result |= ch::CF_AVX2;
+			if (ebx & (1 << 3)) result |= ch::CF_BMI1;
+		}
+	}
+
+	return result;
+}
+#else
+static u32 query_cpu_features() {
+	return 0;
+}
+#endif
+
+u32 ch::get_cpu_features() {
+	static const u32 features = query_cpu_features();
+	return features;
+}
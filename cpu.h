@@ -0,0 +1,38 @@
+#pragma once
+
+#include "types.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CH_CPU_X86 1
+#endif
+
+#ifndef CH_CPU_X86
+#define CH_CPU_X86 0
+#endif
+
+/**
+ * MSVC lets us use any intrinsic anywhere. GCC and clang need to be told per function
+ * which instruction sets the body is allowed to use.
+ */
+#if CH_COMPILER_MSVC
+#define CH_TARGET_AVX2
+#else
+#define CH_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace ch {
+	enum CPU_Feature_Flags {
+		CF_SSE2   = 0x01,
+		CF_SSE4_2 = 0x02,
+		CF_AVX2   = 0x04,
+		CF_POPCNT = 0x08,
+		CF_BMI1   = 0x10,
+	};
+
+	/** Queries cpuid the first time it's called and caches the result. */
+	u32 get_cpu_features();
+
+	CH_FORCEINLINE bool cpu_has_features(u32 flags) {
+		return (ch::get_cpu_features() & flags) == flags;
+	}
+}
@@ -86,7 +86,7 @@ const ch::String ch::Path::get_filename(bool with_extension) {
 				result.data = data + i + 1;
 				result.count = with_extension ? (count - i) : (extension_loc - i - 1);
 				result.allocated = result.count;
-				result.allocator = ch::get_stack_allocator();
+				result.allocator = ch::get_null_allocator();
 				return result;
 			}
 			break;
@@ -97,7 +97,7 @@ const ch::String ch::Path::get_filename(bool with_extension) {
 	result.data = data;
 	result.count = with_extension ? count : extension_loc;
 	result.allocated = result.count;
-	result.allocator = ch::get_stack_allocator();
+	result.allocator = ch::get_null_allocator();
 	return result;
 }
 
@@ -3,6 +3,7 @@
 #include "string.h"
 #include "os.h"
 #include "array.h"
+#include "small_array.h"
 
 #if CH_PLATFORM_WINDOWS
 #include "win32/filesystem_win32.h"
@@ -34,11 +35,7 @@ namespace ch {
 		CH_FORCEINLINE bool operator==(const ch::Path& right) const {
 			if (count != right.count) return false;
 
-			for (usize i = 0; i < count; i++) {
-				if (right[i] != data[i]) return false;
-			}
-
-			return true;
+			return ch::mem_equal(data, right.data, count);
 		}
 
 		CH_FORCEINLINE bool operator!=(const ch::Path& right) const {
@@ -166,7 +163,8 @@ namespace ch {
 	};
 
 	struct Recursive_Directory_Iterator {
-		ch::Array<ch::Directory_Iterator> iterators;
+		// @NOTE(CHall): One per directory deep. Hardly anything goes past 8
+		ch::Small_Array<ch::Directory_Iterator, 8> iterators;
 		usize current_iterator;
 		ch::Path current_path;
 
@@ -0,0 +1,422 @@
+#include "free_list_allocator.h"
+#include "memory.h"
+#include "bits.h"
+
+using Header = ch::Free_List_Allocator_Header;
+
+/**
+ * Every block starts with this. size includes the header and is always a multiple of 16 so the low bits are flags.
+ *
+ * For large blocks prev_size is the size of the block right before it in the chunk, 0 for the first one. For small
+ * blocks it's the size class. next_free and prev_free overlap the start of the user memory so they only exist while
+ * the block is free.
+ */
+struct Block {
+	usize size_and_flags;
+	usize prev_size;
+
+	Block* next_free;
+	Block* prev_free;
+};
+
+const usize block_header_size = 16;
+const usize block_used = 0x01;
+const usize block_small = 0x02;
+const usize block_flags = 0x0f;
+
+/** Smallest block that can hold its own free list links */
+const usize min_block_size = sizeof(Block);
+
+/** Small blocks get carved out of runs this big */
+const usize small_run_size = 64 * 1024;
+
+struct Chunk {
+	Chunk* next;
+	usize size;
+};
+
+const usize chunk_header_size = 16;
+static_assert(sizeof(Chunk) <= chunk_header_size, "Chunk header has to keep blocks 16 byte aligned");
+
+static CH_FORCEINLINE usize get_size(const Block* b) { return b->size_and_flags & ~block_flags; }
+static CH_FORCEINLINE bool is_used(const Block* b) { return (b->size_and_flags & block_used) != 0; }
+static CH_FORCEINLINE Block* get_next_physical(Block* b) { return (Block*)((u8*)b + get_size(b)); }
+static CH_FORCEINLINE Block* get_prev_physical(Block* b) { return (Block*)((u8*)b - b->prev_size); }
+static CH_FORCEINLINE void* get_user_ptr(Block* b) { return (u8*)b + block_header_size; }
+static CH_FORCEINLINE Block* get_block(void* ptr) { return (Block*)((u8*)ptr - block_header_size); }
+
+static CH_FORCEINLINE void set_size(Block* b, usize size, usize flags) {
+	b->size_and_flags = size | flags;
+}
+
+static u32 get_small_class(usize size) {
+	if (size <= 128) return (u32)((size + 15) / 16) - 1;
+
+	// Above 128 it's 4 classes per power of 2
+	const u32 level = ch::find_last_set((u64)(size - 1));
+	const u32 sub = (u32)((size - 1) >> (level - 2)) & 3;
+	return 8 + (level - 7) * 4 + sub;
+}
+
+static usize get_small_class_size(u32 size_class) {
+	if (size_class < 8) return (size_class + 1) * 16;
+
+	const u32 level = 7 + (size_class - 8) / 4;
+	const u32 sub = (size_class - 8) % 4;
+	return ((usize)1 << level) + (sub + 1) * ((usize)1 << (level - 2));
+}
+
+static CH_FORCEINLINE void get_bin(usize size, u32* out_level, u32* out_sub) {
+	const u32 level = ch::find_last_set((u64)size);
+	*out_level = level;
+	*out_sub = (u32)(size >> (level - 2)) & 3;
+}
+
+static void insert_free(Header* header, Block* b) {
+	u32 level, sub;
+	get_bin(get_size(b), &level, &sub);
+
+	Block*& head = (Block*&)header->bins[level][sub];
+	b->next_free = head;
+	b->prev_free = nullptr;
+	if (head) head->prev_free = b;
+	head = b;
+
+	header->bin_bitmap |= 1ull << level;
+	header->sub_bin_bitmaps[level] |= 1u << sub;
+}
+
+static void remove_free(Header* header, Block* b) {
+	u32 level, sub;
+	get_bin(get_size(b), &level, &sub);
+
+	Block*& head = (Block*&)header->bins[level][sub];
+	if (b->prev_free) b->prev_free->next_free = b->next_free;
+	if (b->next_free) b->next_free->prev_free = b->prev_free;
+	if (head == b) head = b->next_free;
+
+	if (!head) {
+		header->sub_bin_bitmaps[level] &= ~(1u << sub);
+		if (!header->sub_bin_bitmaps[level]) header->bin_bitmap &= ~(1ull << level);
+	}
+}
+
+/** First block from a bin where every block is guaranteed to be at least size */
+static Block* find_free(Header* header, usize size) {
+	u32 level, sub;
+	get_bin(size, &level, &sub);
+
+	// Round up to the next bin unless size is exactly on a bin boundary
+	const usize bin_step = (usize)1 << (level - 2);
+	if (size & (bin_step - 1)) {
+		sub += 1;
+		if (sub == ch::free_list_bins_per_level) {
+			sub = 0;
+			level += 1;
+		}
+	}
+	if (level >= ch::free_list_num_bins) return nullptr;
+
+	u32 sub_bitmap = header->sub_bin_bitmaps[level] & (~0u << sub);
+	if (!sub_bitmap) {
+		const u64 bitmap = level + 1 < 64 ? header->bin_bitmap & (~0ull << (level + 1)) : 0;
+		if (!bitmap) return nullptr;
+
+		level = ch::count_trailing_zeros(bitmap);
+		sub_bitmap = header->sub_bin_bitmaps[level];
+	}
+	sub = ch::count_trailing_zeros(sub_bitmap);
+
+	Block* result = (Block*)header->bins[level][sub];
+	remove_free(header, result);
+	return result;
+}
+
+/** Marks b free, merges it with any free neighbours and puts the result in its bin */
+static void release_block(Header* header, Block* b) {
+	usize size = get_size(b);
+
+	Block* next = get_next_physical(b);
+	if (!is_used(next)) {
+		remove_free(header, next);
+		size += get_size(next);
+	}
+
+	if (b->prev_size) {
+		Block* prev = get_prev_physical(b);
+		if (!is_used(prev)) {
+			remove_free(header, prev);
+			size += get_size(prev);
+			b = prev;
+		}
+	}
+
+	set_size(b, size, 0);
+	get_next_physical(b)->prev_size = size;
+	insert_free(header, b);
+}
+
+/** Gives whatever b doesn't need back to the free bins if it's big enough to be a block */
+static void trim_block(Header* header, Block* b, usize size) {
+	const usize block_size = get_size(b);
+	if (block_size - size < min_block_size) return;
+
+	set_size(b, size, b->size_and_flags & block_flags);
+
+	Block* rest = get_next_physical(b);
+	set_size(rest, block_size - size, block_used);
+	rest->prev_size = size;
+	get_next_physical(rest)->prev_size = block_size - size;
+	release_block(header, rest);
+}
+
+/**
+ * The new chunk is one free block that isn't in a bin yet. find_free rounds up to the next bin so it might not find a
+ * block that's only just big enough.
+ */
+static Block* add_chunk(Header* header, usize min_size) {
+	usize size = min_size + chunk_header_size + block_header_size;
+	if (size < header->chunk_size) size = header->chunk_size;
+	size = ch::align_up(size, 16);
+
+	u8* memory = (u8*)header->backing.alloc(size);
+	if (!memory) return nullptr;
+
+	Chunk* chunk = (Chunk*)memory;
+	chunk->next = (Chunk*)header->chunks;
+	chunk->size = size;
+	header->chunks = chunk;
+	header->num_chunks += 1;
+	header->bytes_reserved += size;
+
+	// @NOTE(CHall): The header at the very end of the chunk is a used block of size 0 so merging always stops there
+	const usize block_size = size - chunk_header_size - block_header_size;
+	Block* b = (Block*)(memory + chunk_header_size);
+	set_size(b, block_size, 0);
+	b->prev_size = 0;
+
+	Block* end = get_next_physical(b);
+	set_size(end, 0, block_used);
+	end->prev_size = block_size;
+	return b;
+}
+
+static void* alloc_large(Header* header, usize size, usize alignment) {
+	usize block_size = ch::align_up(size + block_header_size, 16);
+	if (block_size < min_block_size) block_size = min_block_size;
+
+	// Over aligned blocks need room to slide forward and still leave a valid free block in front of them
+	const usize search_size = alignment > 16 ? block_size + alignment + min_block_size : block_size;
+
+	Block* b = find_free(header, search_size);
+	if (!b) {
+		b = add_chunk(header, search_size);
+		if (!b) return nullptr;
+	}
+
+	if (alignment > 16) {
+		u8* user = (u8*)ch::align_up((u8*)get_user_ptr(b), alignment);
+		usize gap = user - (u8*)get_user_ptr(b);
+		if (gap && gap < min_block_size) {
+			user += alignment;
+			gap += alignment;
+		}
+
+		if (gap) {
+			Block* front = b;
+			b = get_block(user);
+			set_size(b, get_size(front) - gap, 0);
+			b->prev_size = gap;
+			get_next_physical(b)->prev_size = get_size(b);
+
+			// @NOTE(CHall): front came out of a bin so the block before it has to be used. No merging needed
+			set_size(front, gap, 0);
+			insert_free(header, front);
+		}
+	}
+
+	set_size(b, get_size(b), block_used);
+	trim_block(header, b, block_size);
+	return get_user_ptr(b);
+}
+
+static void* alloc_small(Header* header, usize size) {
+	const u32 size_class = get_small_class(size);
+
+	Block* b = (Block*)header->small_free[size_class];
+	if (b) {
+		header->small_free[size_class] = b->next_free;
+		return get_user_ptr(b);
+	}
+
+	const usize block_size = get_small_class_size(size_class) + block_header_size;
+	if (header->small_run + block_size > header->small_run_end) {
+		// Whatever is left of the old run is less than one small block so it's just dropped
+		u8* run = (u8*)alloc_large(header, small_run_size - block_header_size, 16);
+		if (!run) return nullptr;
+		header->small_run = run;
+		header->small_run_end = run + small_run_size - block_header_size;
+	}
+
+	b = (Block*)header->small_run;
+	header->small_run += block_size;
+	set_size(b, block_size, block_used | block_small);
+	b->prev_size = size_class;
+	return get_user_ptr(b);
+}
+
+static usize get_usable_size(Block* b) {
+	if (b->size_and_flags & block_small) return get_small_class_size((u32)b->prev_size);
+	return get_size(b) - block_header_size;
+}
+
+static void free_block(Header* header, void* ptr) {
+	Block* b = get_block(ptr);
+	if (b->size_and_flags & block_small) {
+		b->next_free = (Block*)header->small_free[b->prev_size];
+		header->small_free[b->prev_size] = b;
+	} else {
+		release_block(header, b);
+	}
+}
+
+static void* alloc_block(Header* header, usize size, usize alignment) {
+	if (size <= ch::free_list_small_max && alignment <= 16) return alloc_small(header, size);
+	return alloc_large(header, size, alignment);
+}
+
+static CH_FORCEINLINE void add_bytes_in_use(Header* header, usize size) {
+	header->bytes_in_use += size;
+	if (header->bytes_in_use > header->peak_bytes_in_use) header->peak_bytes_in_use = header->bytes_in_use;
+}
+
+static void* free_list_alloc(const ch::Allocator& allocator, void* ptr, usize old_size, usize size, usize alignment) {
+	Header* header = allocator.get_header<Header>();
+
+	if (!ptr) {
+		if (!size) return nullptr;
+
+		void* result = alloc_block(header, size, alignment);
+		if (!result) {
+			header->num_failed_allocations += 1;
+			return nullptr;
+		}
+
+		header->num_allocations += 1;
+		header->total_allocations += 1;
+		add_bytes_in_use(header, get_usable_size(get_block(result)));
+		return result;
+	}
+
+	Block* b = get_block(ptr);
+	const usize usable_size = get_usable_size(b);
+
+	if (!size) {
+		header->num_allocations -= 1;
+		header->bytes_in_use -= usable_size;
+		free_block(header, ptr);
+		return nullptr;
+	}
+
+	if (b->size_and_flags & block_small) {
+		if (size <= usable_size) return ptr;
+	} else {
+		const usize block_size = ch::align_up(size + block_header_size, 16);
+
+		// Large blocks can grow into a free neighbour and give back what they don't need when they shrink
+		if (block_size <= get_size(b)) {
+			trim_block(header, b, block_size < min_block_size ? min_block_size : block_size);
+			header->bytes_in_use -= usable_size - get_usable_size(b);
+			return ptr;
+		}
+
+		Block* next = get_next_physical(b);
+		if (!is_used(next) && get_size(b) + get_size(next) >= block_size) {
+			remove_free(header, next);
+			set_size(b, get_size(b) + get_size(next), block_used);
+			get_next_physical(b)->prev_size = get_size(b);
+			trim_block(header, b, block_size);
+			add_bytes_in_use(header, get_usable_size(b) - usable_size);
+			return ptr;
+		}
+	}
+
+	void* result = alloc_block(header, size, alignment);
+	if (!result) {
+		header->num_failed_allocations += 1;
+		return nullptr;
+	}
+
+	const usize copy_size = old_size ? old_size : usable_size;
+	ch::mem_copy(result, ptr, copy_size < size ? copy_size : size);
+	add_bytes_in_use(header, get_usable_size(get_block(result)));
+	header->bytes_in_use -= usable_size;
+	free_block(header, ptr);
+	return result;
+}
+
+/**
+ * Fragmentation only looks at the large bins. Freed small blocks can only ever be reused by their own class so they
+ * count as in use by the allocator.
+ */
+static ch::Allocator_Stats free_list_stats(const ch::Allocator& allocator) {
+	const Header* header = allocator.get_header<Header>();
+
+	ch::Allocator_Stats result = {};
+	result.bytes_in_use = header->bytes_in_use;
+	result.peak_bytes_in_use = header->peak_bytes_in_use;
+	result.bytes_reserved = header->bytes_reserved;
+	result.num_allocations = header->num_allocations;
+	result.total_allocations = header->total_allocations;
+	result.num_failed_allocations = header->num_failed_allocations;
+
+	usize total_free = 0;
+	usize largest_free = 0;
+	for (usize level = 0; level < ch::free_list_num_bins; level++) {
+		if (!(header->bin_bitmap & (1ull << level))) continue;
+
+		for (usize sub = 0; sub < ch::free_list_bins_per_level; sub++) {
+			for (const Block* it = (const Block*)header->bins[level][sub]; it; it = it->next_free) {
+				const usize size = get_size(it);
+				total_free += size;
+				if (size > largest_free) largest_free = size;
+			}
+		}
+	}
+
+	if (total_free) result.fragmentation = 1.f - (f32)largest_free / (f32)total_free;
+	return result;
+}
+
+ch::Allocator ch::make_free_list_allocator(usize chunk_size, const ch::Allocator& backing) {
+	assert(chunk_size >= small_run_size);
+
+	ch::Allocator backing_allocator = backing;
+	Header* header = (Header*)backing_allocator.alloc(sizeof(Header));
+	if (!header) return {};
+
+	ch::mem_zero(header, sizeof(Header));
+	header->backing = backing;
+	header->chunk_size = chunk_size;
+
+	ch::Allocator result;
+	result.data = (u8*)header;
+	result.func = free_list_alloc;
+	result.stats_func = free_list_stats;
+	return result;
+}
+
+void ch::free_free_list_allocator(ch::Allocator* allocator) {
+	Header* header = allocator->get_header<Header>();
+	ch::Allocator backing = header->backing;
+
+	Chunk* chunk = (Chunk*)header->chunks;
+	while (chunk) {
+		Chunk* next = chunk->next;
+		backing.free(chunk);
+		chunk = next;
+	}
+
+	backing.free(header);
+	allocator->data = nullptr;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "allocator.h"
+
+namespace ch {
+	/**
+	 * Segregated free list allocator
+	 *
+	 * Small allocations are rounded up to one of a handful of size classes and every class keeps its own free list.
+	 * They're carved out of runs back to back so things allocated together stay together. Freed small blocks only ever
+	 * go back to their class, they're never merged.
+	 *
+	 * Anything bigger is a large block. Large blocks have boundary tags so a free merges them with free neighbours and
+	 * the free ones live in bins of 4 per power of 2 with a bitmap over the bins. Finding a block that fits is a couple
+	 * of bit scans so alloc and free are O(1) either way.
+	 *
+	 * Memory comes in chunks from the backing allocator and only goes back to it when the allocator is freed.
+	 */
+	const usize free_list_small_max = 1024;
+	const usize free_list_num_small_classes = 20;
+	const usize free_list_num_bins = 64;
+	const usize free_list_bins_per_level = 4;
+
+	struct Free_List_Allocator_Header {
+		ch::Allocator backing;
+		usize chunk_size;
+		void* chunks;
+		usize num_chunks;
+
+		void* small_free[free_list_num_small_classes];
+		u8* small_run;
+		u8* small_run_end;
+
+		u64 bin_bitmap;
+		u32 sub_bin_bitmaps[free_list_num_bins];
+		void* bins[free_list_num_bins][free_list_bins_per_level];
+
+		usize bytes_reserved;
+		usize bytes_in_use;
+		usize peak_bytes_in_use;
+		usize num_allocations;
+		usize total_allocations;
+		usize num_failed_allocations;
+	};
+
+	ch::Allocator make_free_list_allocator(usize chunk_size = 1024 * 1024, const ch::Allocator& backing = ch::get_heap_allocator());
+	void free_free_list_allocator(ch::Allocator* allocator);
+}
@@ -53,7 +53,7 @@ namespace ch {
 		}
 
 		void free() {
-			if (data) allocator.free(data);
+			if (data) allocator.free_sized(data, allocated * sizeof(T));
 		}
 
 		void resize(usize new_gap_size) {
@@ -68,7 +68,7 @@ namespace ch {
 			const usize new_size = old_size + new_gap_size;
 
 			T* old_data = data;
-			T* new_data = (T*)allocator.realloc(old_data, new_size * sizeof(T));
+			T* new_data = (T*)allocator.realloc_sized(old_data, old_size * sizeof(T), new_size * sizeof(T));
 			assert(new_data);
 
 			data = new_data;
@@ -0,0 +1,340 @@
+#include "heap_profiler.h"
+#include "memory.h"
+#include "atomics.h"
+#include "hash.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+volatile u32 ch::priv_heap_profiler_running = 0;
+volatile u64 ch::priv_heap_profiler_num_live_samples = 0;
+
+/**
+ * All of the bookkeeping is fixed size and allocated straight from the os the first time the profiler starts. It's
+ * never freed so a thread that's still looking something up while the profiler stops can't touch freed memory.
+ *
+ * Recording a sample takes the lock. That only happens about once every sample_interval bytes so it's not worth
+ * anything fancier. Frees have to check whether the pointer was sampled which happens all the time, so that lookup
+ * doesn't take the lock.
+ */
+const usize max_sites = 1 << 13;
+const usize site_lookup_size = max_sites * 2;
+const usize max_live_samples = 1 << 16;
+
+struct Live_Sample {
+	void* volatile ptr;
+	u32 site;
+	u64 bytes;
+	u64 count;
+};
+
+static void* const tombstone = (void*)1;
+
+/**
+ * Count of live samples per hash bucket. The sample table is too big to stay in cache so without this every free
+ * would miss on it. Saturated buckets are never decremented, they just stop filtering until the profiler stops.
+ */
+const usize sample_filter_size = 1 << 14;
+static volatile u8 sample_filter[sample_filter_size];
+
+struct Heap_Profiler_State {
+	ch::Spin_Lock lock;
+	usize sample_interval;
+	f64 start_time;
+
+	ch::Heap_Profile_Site* sites;
+	u32* site_lookup;
+	usize num_sites;
+
+	Live_Sample* volatile samples;
+	u64 num_dropped;
+};
+
+static Heap_Profiler_State profiler;
+
+thread_local s64 ch::priv_heap_profiler_bytes_until_sample = 0;
+static thread_local u64 sample_rng = 0;
+static volatile u64 sample_rng_seed = 0;
+
+static f64 get_wall_time() {
+	timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (f64)ts.tv_sec + (f64)ts.tv_nsec * 1e-9;
+}
+
+static CH_FORCEINLINE usize hash_pointer(void* ptr) {
+	return (usize)((((u64)ptr >> 4) * 0x9e3779b97f4a7c15ull) >> 40);
+}
+
+/** Exponentially distributed so the samples don't line up with any pattern in the allocations. Mean is sample_interval */
+static s64 next_sample_distance() {
+	if (!sample_rng) {
+		sample_rng = (ch::atomic_fetch_add(&sample_rng_seed, 1) + 1) * 0x9e3779b97f4a7c15ull ^ (u64)&sample_rng;
+		sample_rng |= 1;
+	}
+
+	sample_rng ^= sample_rng >> 12;
+	sample_rng ^= sample_rng << 25;
+	sample_rng ^= sample_rng >> 27;
+	const u64 r = sample_rng * 2685821657736338717ull;
+	const f64 u = (f64)((r >> 11) + 1) * (1.0 / 9007199254740992.0);
+
+	const f64 result = -::log(u) * (f64)profiler.sample_interval;
+	return result < 1.0 ? 1 : (s64)result;
+}
+
+static u32 find_or_add_site(void** frames, u32 num_frames) {
+	const usize hash = (usize)ch::fnv1_hash(frames, num_frames * sizeof(void*));
+	for (usize i = 0; i < site_lookup_size; i++) {
+		const usize index = (hash + i) & (site_lookup_size - 1);
+		const u32 entry = profiler.site_lookup[index];
+
+		if (!entry) {
+			if (profiler.num_sites == max_sites) return U32_MAX;
+
+			const u32 id = (u32)profiler.num_sites;
+			ch::Heap_Profile_Site& site = profiler.sites[id];
+			ch::mem_zero(&site, sizeof(site));
+			site.id = id;
+			site.num_frames = num_frames;
+			ch::mem_copy(site.frames, frames, num_frames * sizeof(void*));
+
+			profiler.num_sites += 1;
+			profiler.site_lookup[index] = id + 1;
+			return id;
+		}
+
+		const ch::Heap_Profile_Site& site = profiler.sites[entry - 1];
+		if (site.num_frames == num_frames && ch::mem_equal(site.frames, frames, num_frames * sizeof(void*))) {
+			return entry - 1;
+		}
+	}
+
+	return U32_MAX;
+}
+
+void ch::priv_heap_profiler_on_alloc(void* ptr, usize size) {
+	// A thread's first allocation only sets up its countdown. Otherwise every new thread's first allocation gets sampled.
+	const bool first_on_thread = !sample_rng;
+	ch::priv_heap_profiler_bytes_until_sample = next_sample_distance();
+	if (first_on_thread) return;
+
+	// Skip this and ch::malloc/realloc so the first frame is whoever called them
+	void* frames[ch::heap_profile_max_frames];
+	const u32 num_frames = ch::capture_stack_trace(frames, ch::heap_profile_max_frames, 2);
+
+	// An allocation of size bytes gets sampled with probability 1 - e^(-size / interval). Weight it by the inverse
+	// so the estimate comes out unbiased no matter how big or small it is.
+	const f64 probability = 1.0 - ::exp(-(f64)size / (f64)profiler.sample_interval);
+	const f64 weight = probability > 0.0 ? 1.0 / probability : 1.0;
+	const u64 count = (u64)(weight + 0.5);
+	const u64 bytes = (u64)(weight * (f64)size + 0.5);
+
+	profiler.lock.lock();
+	defer(profiler.lock.unlock());
+
+	if (!ch::priv_heap_profiler_running) return;
+
+	const u32 site_id = find_or_add_site(frames, num_frames);
+	if (site_id == U32_MAX) {
+		profiler.num_dropped += 1;
+		return;
+	}
+
+	ch::Heap_Profile_Site& site = profiler.sites[site_id];
+	site.total_bytes += bytes;
+	site.total_count += count;
+
+	Live_Sample* samples = profiler.samples;
+	const usize start = hash_pointer(ptr);
+	for (usize i = 0; i < max_live_samples / 4; i++) {
+		Live_Sample& it = samples[(start + i) & (max_live_samples - 1)];
+		void* const slot_ptr = ch::atomic_load(&it.ptr);
+		if (slot_ptr && slot_ptr != tombstone) continue;
+
+		it.site = site_id;
+		it.bytes = bytes;
+		it.count = count;
+		ch::atomic_store(&it.ptr, ptr);
+
+		site.live_bytes += bytes;
+		site.live_count += count;
+
+		volatile u8& filter = sample_filter[start & (sample_filter_size - 1)];
+		if (filter != U8_MAX) filter += 1;
+		ch::atomic_fetch_add(&ch::priv_heap_profiler_num_live_samples, 1);
+		return;
+	}
+
+	profiler.num_dropped += 1;
+}
+
+void ch::priv_heap_profiler_on_free(void* ptr) {
+	const usize start = hash_pointer(ptr);
+	volatile u8& filter = sample_filter[start & (sample_filter_size - 1)];
+	if (!filter) return;
+
+	Live_Sample* samples = ch::atomic_load(&profiler.samples);
+	if (!samples) return;
+
+	for (usize i = 0; i < max_live_samples; i++) {
+		const usize index = (start + i) & (max_live_samples - 1);
+		void* const slot_ptr = ch::atomic_load(&samples[index].ptr);
+		if (!slot_ptr) return;
+		if (slot_ptr != ptr) continue;
+
+		profiler.lock.lock();
+		defer(profiler.lock.unlock());
+
+		Live_Sample& it = samples[index];
+		if (it.ptr != ptr) return;
+
+		ch::Heap_Profile_Site& site = profiler.sites[it.site];
+		site.live_bytes -= it.bytes;
+		site.live_count -= it.count;
+
+		// If nothing comes after this slot no probe can be going past it so it can go straight back to empty
+		if (filter != U8_MAX) filter -= 1;
+
+		void* const next = samples[(index + 1) & (max_live_samples - 1)].ptr;
+		ch::atomic_store(&it.ptr, next ? tombstone : (void*)nullptr);
+		ch::atomic_fetch_add(&ch::priv_heap_profiler_num_live_samples, (u64)-1);
+		return;
+	}
+}
+
+bool ch::start_heap_profiler(usize sample_interval) {
+	assert(sample_interval > 0);
+
+	profiler.lock.lock();
+	defer(profiler.lock.unlock());
+
+	if (!profiler.sites) {
+		profiler.sites = (ch::Heap_Profile_Site*)ch::os_malloc(max_sites * sizeof(ch::Heap_Profile_Site));
+		profiler.site_lookup = (u32*)ch::os_malloc(site_lookup_size * sizeof(u32));
+		Live_Sample* samples = (Live_Sample*)ch::os_malloc(max_live_samples * sizeof(Live_Sample));
+		if (!profiler.sites || !profiler.site_lookup || !samples) return false;
+
+		ch::mem_zero(samples, max_live_samples * sizeof(Live_Sample));
+		ch::atomic_store(&profiler.samples, samples);
+	}
+
+	if (!ch::priv_heap_profiler_running) {
+		ch::mem_zero(profiler.site_lookup, site_lookup_size * sizeof(u32));
+		profiler.num_sites = 0;
+		profiler.num_dropped = 0;
+		profiler.start_time = get_wall_time();
+	}
+
+	profiler.sample_interval = sample_interval;
+	ch::atomic_store(&ch::priv_heap_profiler_running, 1);
+	return true;
+}
+
+void ch::stop_heap_profiler() {
+	profiler.lock.lock();
+	defer(profiler.lock.unlock());
+
+	ch::atomic_store(&ch::priv_heap_profiler_running, 0);
+	if (profiler.samples) {
+		for (usize i = 0; i < max_live_samples; i++) {
+			ch::atomic_store(&profiler.samples[i].ptr, (void*)nullptr);
+		}
+		ch::mem_zero((void*)sample_filter, sample_filter_size);
+	}
+	ch::atomic_store(&ch::priv_heap_profiler_num_live_samples, 0);
+}
+
+bool ch::is_heap_profiler_running() {
+	return ch::atomic_load(&ch::priv_heap_profiler_running) != 0;
+}
+
+ch::Heap_Profile_Snapshot ch::take_heap_profile_snapshot() {
+	ch::Heap_Profile_Snapshot result;
+
+	profiler.lock.lock();
+	defer(profiler.lock.unlock());
+
+	result.time = get_wall_time() - profiler.start_time;
+	result.sample_interval = profiler.sample_interval;
+	if (!profiler.num_sites) return result;
+
+	// Sites are copied in id order so the same site is at the same index in every snapshot
+	result.sites = (ch::Heap_Profile_Site*)ch::os_malloc(profiler.num_sites * sizeof(ch::Heap_Profile_Site));
+	if (!result.sites) return result;
+
+	ch::mem_copy(result.sites, profiler.sites, profiler.num_sites * sizeof(ch::Heap_Profile_Site));
+	result.num_sites = profiler.num_sites;
+	return result;
+}
+
+void ch::Heap_Profile_Snapshot::free() {
+	if (sites) ch::os_free(sites);
+	sites = nullptr;
+	num_sites = 0;
+}
+
+bool ch::write_heap_profile(const char* path, const ch::Heap_Profile_Snapshot& snapshot, const ch::Heap_Profile_Snapshot* previous) {
+	FILE* file = fopen(path, "w");
+	if (!file) return false;
+	defer(fclose(file));
+
+	u32* order = (u32*)ch::os_malloc((snapshot.num_sites + 1) * sizeof(u32));
+	if (!order) return false;
+	defer(ch::os_free(order));
+
+	u64 live_bytes = 0;
+	u64 total_bytes = 0;
+	for (usize i = 0; i < snapshot.num_sites; i++) {
+		order[i] = (u32)i;
+		live_bytes += snapshot.sites[i].live_bytes;
+		total_bytes += snapshot.sites[i].total_bytes;
+	}
+
+	// Shell sort by live bytes. Doesn't need any memory and there's at most a few thousand sites.
+	for (usize gap = snapshot.num_sites / 2; gap > 0; gap /= 2) {
+		for (usize i = gap; i < snapshot.num_sites; i++) {
+			const u32 it = order[i];
+			usize j = i;
+			for (; j >= gap && snapshot.sites[order[j - gap]].live_bytes < snapshot.sites[it].live_bytes; j -= gap) {
+				order[j] = order[j - gap];
+			}
+			order[j] = it;
+		}
+	}
+
+	const f64 elapsed = previous ? snapshot.time - previous->time : 0.0;
+
+	fprintf(file, "heap profile: %llu sites, sample interval %llu bytes, %.3f seconds since start\n",
+		(unsigned long long)snapshot.num_sites, (unsigned long long)snapshot.sample_interval, snapshot.time);
+	fprintf(file, "estimated live bytes %llu, estimated allocated bytes %llu\n", (unsigned long long)live_bytes, (unsigned long long)total_bytes);
+	if (previous) fprintf(file, "rates are over the last %.3f seconds\n", elapsed);
+	fprintf(file, "\n%14s %10s %14s %12s %14s %12s  frames\n", "live bytes", "live count", "total bytes", "total count", "bytes/s", "allocs/s");
+
+	for (usize i = 0; i < snapshot.num_sites; i++) {
+		const ch::Heap_Profile_Site& it = snapshot.sites[order[i]];
+
+		f64 bytes_per_second = 0.0;
+		f64 allocs_per_second = 0.0;
+		if (previous && elapsed > 0.0) {
+			u64 previous_bytes = 0;
+			u64 previous_count = 0;
+			if (it.id < previous->num_sites) {
+				previous_bytes = previous->sites[it.id].total_bytes;
+				previous_count = previous->sites[it.id].total_count;
+			}
+			bytes_per_second = (f64)(it.total_bytes - previous_bytes) / elapsed;
+			allocs_per_second = (f64)(it.total_count - previous_count) / elapsed;
+		}
+
+		fprintf(file, "%14llu %10llu %14llu %12llu %14.0f %12.0f ", (unsigned long long)it.live_bytes, (unsigned long long)it.live_count,
+			(unsigned long long)it.total_bytes, (unsigned long long)it.total_count, bytes_per_second, allocs_per_second);
+		for (u32 j = 0; j < it.num_frames; j++) {
+			fprintf(file, " %p", it.frames[j]);
+		}
+		fprintf(file, "\n");
+	}
+
+	return true;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "types.h"
+
+/**
+ * Sampling heap profiler
+ *
+ * Meant to be left on in release builds. Roughly one allocation per sample_interval bytes gets its stack captured and
+ * everything else only pays for a thread local countdown. Sampled numbers are scaled back up so the live and total
+ * figures are estimates of the whole heap, not just the samples.
+ *
+ * Only allocations that go through ch::malloc/realloc/free are seen.
+ */
+namespace ch {
+	const u32 heap_profile_max_frames = 16;
+
+	struct Heap_Profile_Site {
+		u32 id;
+		u32 num_frames;
+		void* frames[heap_profile_max_frames];
+
+		u64 live_bytes;
+		u64 live_count;
+		u64 total_bytes;
+		u64 total_count;
+	};
+
+	struct Heap_Profile_Snapshot {
+		f64 time;
+		usize sample_interval;
+		Heap_Profile_Site* sites = nullptr;
+		usize num_sites = 0;
+
+		void free();
+	};
+
+	bool start_heap_profiler(usize sample_interval = 512 * 1024);
+	void stop_heap_profiler();
+	bool is_heap_profiler_running();
+
+	/** Copies the current per site numbers out. Free it with Heap_Profile_Snapshot::free */
+	ch::Heap_Profile_Snapshot take_heap_profile_snapshot();
+
+	/**
+	 * Writes one line per site sorted by live bytes with the raw return addresses of the stack
+	 *
+	 * If previous is passed in the allocation rate of every site between the two snapshots gets written too.
+	 */
+	bool write_heap_profile(const char* path, const ch::Heap_Profile_Snapshot& snapshot, const ch::Heap_Profile_Snapshot* previous = nullptr);
+
+	/** Implemented per platform. @returns number of frames written */
+	u32 capture_stack_trace(void** out_frames, u32 max_frames, u32 frames_to_skip);
+
+	// @NOTE(CHall): Only exposed so ch::malloc and ch::free can early out without a function call. on_alloc is only called once the countdown runs out
+	extern volatile u32 priv_heap_profiler_running;
+	extern volatile u64 priv_heap_profiler_num_live_samples;
+	extern thread_local s64 priv_heap_profiler_bytes_until_sample;
+	void priv_heap_profiler_on_alloc(void* ptr, usize size);
+	void priv_heap_profiler_on_free(void* ptr);
+}
@@ -0,0 +1,108 @@
+#include "../memory.h"
+#include "../heap_profiler.h"
+
+#if !CH_PLATFORM_LINUX
+#error This should not be compiling on this platform
+#endif
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <execinfo.h>
+#include <malloc.h>
+
+void* ch::os_malloc(usize size) {
+    return ::malloc(size);
+}
+
+void* ch::os_realloc(void* ptr, usize size) {
+    return ::realloc(ptr, size);
+}
+
+void ch::os_free(void* ptr) {
+    ::free(ptr);
+}
+
+void ch::get_os_heap_usage(usize* out_bytes_in_use, usize* out_bytes_reserved) {
+    // @NOTE(CHall): Big blocks are mmapped on their own and only show up in hblkhd
+    const struct mallinfo2 info = mallinfo2();
+    *out_bytes_in_use = info.uordblks + info.hblkhd;
+    *out_bytes_reserved = info.arena + info.hblkhd;
+}
+
+u32 ch::capture_stack_trace(void** out_frames, u32 max_frames, u32 frames_to_skip) {
+    const u32 max_capture = 64;
+    void* frames[max_capture];
+    const s32 num_frames = backtrace(frames, (s32)max_capture);
+
+    u32 result = 0;
+    for (s32 i = (s32)frames_to_skip + 1; i < num_frames && result < max_frames; i++) {
+        out_frames[result++] = frames[i];
+    }
+    return result;
+}
+
+/** Transparent huge pages are always 2mb on x64 */
+const usize huge_page_size = 2 * 1024 * 1024;
+
+usize ch::get_page_size() {
+    static usize page_size = 0;
+    if (!page_size) page_size = (usize)sysconf(_SC_PAGESIZE);
+    return page_size;
+}
+
+static CH_FORCEINLINE void get_page_range(void* ptr, usize size, u8** out_start, usize* out_size) {
+    const usize page_mask = ch::get_page_size() - 1;
+    const usize start = (usize)ptr & ~page_mask;
+    const usize end = ((usize)ptr + size + page_mask) & ~page_mask;
+    *out_start = (u8*)start;
+    *out_size = end - start;
+}
+
+void* ch::reserve_memory(usize size, u32 flags) {
+    const usize page_mask = ch::get_page_size() - 1;
+    size = (size + page_mask) & ~page_mask;
+
+    // @NOTE(CHall): The kernel only backs a range with huge pages if it's 2mb aligned. Over reserve and trim the ends so it is.
+    const bool huge_pages = (flags & ch::VMF_Huge_Pages) && size >= huge_page_size;
+    const usize reserve_size = huge_pages ? size + huge_page_size : size;
+
+    void* ptr = mmap(nullptr, reserve_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (ptr == MAP_FAILED) return nullptr;
+    if (!huge_pages) return ptr;
+
+    u8* const start = (u8*)ptr;
+    u8* const aligned = (u8*)(((usize)start + huge_page_size - 1) & ~(huge_page_size - 1));
+    u8* const end = start + reserve_size;
+    if (aligned > start) munmap(start, aligned - start);
+    if (end > aligned + size) munmap(aligned + size, end - (aligned + size));
+
+    madvise(aligned, size, MADV_HUGEPAGE);
+    return aligned;
+}
+
+bool ch::commit_memory(void* ptr, usize size) {
+    u8* start;
+    usize range_size;
+    get_page_range(ptr, size, &start, &range_size);
+
+    // Pages get their physical memory the first time they're touched. Until then this only changes the protection.
+    return mprotect(start, range_size, PROT_READ | PROT_WRITE) == 0;
+}
+
+void ch::decommit_memory(void* ptr, usize size) {
+    u8* start;
+    usize range_size;
+    get_page_range(ptr, size, &start, &range_size);
+
+    madvise(start, range_size, MADV_DONTNEED);
+    mprotect(start, range_size, PROT_NONE);
+}
+
+void ch::release_memory(void* ptr, usize size) {
+    u8* start;
+    usize range_size;
+    get_page_range(ptr, size, &start, &range_size);
+
+    munmap(start, range_size);
+}
@@ -0,0 +1,86 @@
+#include "../thread.h"
+#include "../memory.h"
+
+#if !CH_PLATFORM_LINUX
+#error This should not be compiling on this platform
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <unistd.h>
+
+struct Thread_Start {
+    ch::Thread_Func func;
+    void* param;
+};
+
+static void* thread_proc(void* param) {
+    Thread_Start start = *(Thread_Start*)param;
+    ch::os_free(param);
+
+    start.func(start.param);
+    return nullptr;
+}
+
+static_assert(sizeof(pthread_t) <= sizeof(void*), "pthread_t has to fit in Thread::handle");
+
+bool ch::create_thread(ch::Thread_Func func, void* param, ch::Thread* out_thread) {
+    Thread_Start* start = (Thread_Start*)ch::os_malloc(sizeof(Thread_Start));
+    if (!start) return false;
+    start->func = func;
+    start->param = param;
+
+    pthread_t thread;
+    if (pthread_create(&thread, nullptr, thread_proc, start) != 0) {
+        ch::os_free(start);
+        return false;
+    }
+
+    out_thread->handle = (void*)thread;
+    return true;
+}
+
+void ch::join_thread(ch::Thread* thread) {
+    pthread_join((pthread_t)thread->handle, nullptr);
+    thread->handle = nullptr;
+}
+
+bool ch::create_semaphore(u32 initial_count, ch::Semaphore* out_semaphore) {
+    sem_t* semaphore = (sem_t*)ch::os_malloc(sizeof(sem_t));
+    if (!semaphore) return false;
+
+    if (sem_init(semaphore, 0, initial_count) != 0) {
+        ch::os_free(semaphore);
+        return false;
+    }
+
+    out_semaphore->handle = semaphore;
+    return true;
+}
+
+void ch::free_semaphore(ch::Semaphore* semaphore) {
+    sem_destroy((sem_t*)semaphore->handle);
+    ch::os_free(semaphore->handle);
+    semaphore->handle = nullptr;
+}
+
+void ch::signal_semaphore(ch::Semaphore* semaphore, u32 count) {
+    for (u32 i = 0; i < count; i++) {
+        sem_post((sem_t*)semaphore->handle);
+    }
+}
+
+void ch::wait_semaphore(ch::Semaphore* semaphore) {
+    while (sem_wait((sem_t*)semaphore->handle) != 0 && errno == EINTR);
+}
+
+void ch::yield_thread() {
+    sched_yield();
+}
+
+u32 ch::get_num_cpu_cores() {
+    const long result = sysconf(_SC_NPROCESSORS_ONLN);
+    return result > 0 ? (u32)result : 1;
+}
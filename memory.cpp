@@ -1,52 +1,172 @@
 #include "memory.h"
 #include "allocator.h"
+#include "cpu.h"
+#include "bits.h"
+#include "heap_profiler.h"
+#include "thread_cache_allocator.h"
+
+static ch::Malloc_Backend malloc_backend = ch::MB_OS;
+
+void ch::set_malloc_backend(ch::Malloc_Backend backend) {
+	malloc_backend = backend;
+}
+
+ch::Malloc_Backend ch::get_malloc_backend() {
+	return malloc_backend;
+}
+
+/** Everything but the countdown is out of line so the common case stays a few instructions */
+static CH_FORCEINLINE void profile_alloc(void* ptr, usize size) {
+	if (!ch::priv_heap_profiler_running || !ptr) return;
+
+	s64& bytes_until_sample = ch::priv_heap_profiler_bytes_until_sample;
+	bytes_until_sample -= (s64)size;
+	if (bytes_until_sample <= 0) ch::priv_heap_profiler_on_alloc(ptr, size);
+}
+
+void* ch::malloc(usize size) {
+	void* result = malloc_backend == ch::MB_Thread_Cache ? ch::thread_cache_malloc(size) : ch::os_malloc(size);
+	profile_alloc(result, size);
+	return result;
+}
+
+void* ch::realloc(void* ptr, usize size) {
+	if (!ptr) return ch::malloc(size);
+
+	// @NOTE(CHall): Has to come off the sampled list before the os can hand the address to someone else
+	if (ch::priv_heap_profiler_num_live_samples) ch::priv_heap_profiler_on_free(ptr);
+
+	// @NOTE(CHall): Memory stays with whichever backend it came from even if the backend changed since
+	void* result = ch::thread_cache_owns(ptr) ? ch::thread_cache_realloc(ptr, size) : ch::os_realloc(ptr, size);
+	profile_alloc(result, size);
+	return result;
+}
+
+void ch::free(void* ptr) {
+	if (!ptr) return;
+
+	if (ch::priv_heap_profiler_num_live_samples) ch::priv_heap_profiler_on_free(ptr);
+	if (ch::thread_cache_owns(ptr)) {
+		ch::thread_cache_free(ptr);
+	} else {
+		ch::os_free(ptr);
+	}
+}
 
 #if CH_BUILD_DEBUG
+#include "atomics.h"
+#include "string.h"
+
+#include <stdio.h>
+
+/**
+ * Debug allocation tracking
+ *
+ * Nothing in here takes a lock. The counters are sharded per thread so threads don't fight over the same cache line
+ * and the live allocations live in a fixed size open addressed registry that's claimed with a single CAS. Each
+ * allocation remembers the slot it claimed so freeing it never has to search.
+ */
 struct Allocation_Header {
-	void* allocation;
 	usize size;
-
 	const char* file;
 	u64 line;
+	u64 slot;
+};
+
+static const u64 untracked_slot = U64_MAX;
+
+struct alignas(64) Debug_Counter_Shard {
+	volatile u64 total_allocated;
+	volatile u64 num_allocations;
+};
+
+const usize debug_shard_count = 64;
+static Debug_Counter_Shard debug_shards[debug_shard_count];
+static volatile u32 debug_next_shard = 0;
+static thread_local u32 debug_shard_index = U32_MAX;
 
-	Allocation_Header* parent;
-	Allocation_Header* child;
+static Debug_Counter_Shard& get_debug_shard() {
+	if (debug_shard_index == U32_MAX) {
+		debug_shard_index = ch::atomic_fetch_add(&debug_next_shard, 1) % debug_shard_count;
+	}
+
+	return debug_shards[debug_shard_index];
+}
+
+struct Debug_Live_Slot {
+	void* volatile allocation;
+	usize size;
+	const char* file;
+	u64 line;
 };
 
-Allocation_Header* first_header = nullptr;
-usize total_allocated = 0;
-usize num_allocations = 0;
+const usize debug_registry_size = 1 << 18;
+const usize debug_registry_max_probe = 128;
+static Debug_Live_Slot* volatile debug_registry = nullptr;
+static volatile u64 debug_num_untracked = 0;
+
+static Debug_Live_Slot* get_debug_registry() {
+	Debug_Live_Slot* result = ch::atomic_load(&debug_registry);
+	if (result) return result;
+
+	// @NOTE(CHall): Whoever loses the race just throws theirs away
+	const usize registry_bytes = debug_registry_size * sizeof(Debug_Live_Slot);
+	Debug_Live_Slot* registry = (Debug_Live_Slot*)ch::os_malloc(registry_bytes);
+	ch::mem_zero(registry, registry_bytes);
+
+	if (ch::atomic_compare_exchange(&debug_registry, (Debug_Live_Slot*)nullptr, registry)) return registry;
+
+	ch::os_free(registry);
+	return ch::atomic_load(&debug_registry);
+}
+
+static u64 track_allocation(void* allocation, usize size, const char* file, u64 line) {
+	Debug_Live_Slot* registry = get_debug_registry();
+
+	const u64 hash = ((u64)allocation >> 4) * 0x9e3779b97f4a7c15ull;
+	const usize start = (usize)(hash >> 40) & (debug_registry_size - 1);
+	for (usize i = 0; i < debug_registry_max_probe; i++) {
+		const usize index = (start + i) & (debug_registry_size - 1);
+		Debug_Live_Slot& it = registry[index];
+
+		if (ch::atomic_load(&it.allocation)) continue;
+		if (!ch::atomic_compare_exchange(&it.allocation, (void*)nullptr, allocation)) continue;
+
+		it.size = size;
+		it.file = file;
+		it.line = line;
+		return index;
+	}
+
+	ch::atomic_fetch_add(&debug_num_untracked, 1);
+	return untracked_slot;
+}
+
+static void untrack_allocation(u64 slot) {
+	if (slot == untracked_slot) {
+		ch::atomic_fetch_add(&debug_num_untracked, (u64)-1);
+		return;
+	}
+
+	ch::atomic_store(&debug_registry[slot].allocation, (void*)nullptr);
+}
 
 void* ch::debug_malloc(usize size, const char* file, u64 line) {
-	const usize orig_size = size;
-	size += sizeof(Allocation_Header);
-	u8* result = (u8*)ch::malloc(size);
+	const usize allocation_size = size + sizeof(Allocation_Header);
+	u8* result = (u8*)ch::malloc(allocation_size);
+	if (!result) return nullptr;
 
 	Allocation_Header* header = (Allocation_Header*)result;
 	result += sizeof(Allocation_Header);
 
-	*header = {};
-	header->allocation = result;
-	header->size = orig_size;
+	header->size = size;
 	header->file = file;
 	header->line = line;
+	header->slot = track_allocation(result, size, file, line);
 
-#if 0
-	if (!first_header) {
-		first_header = header;
-	} else {
-		Allocation_Header* current = first_header;
-		while(current->child) {
-			current = current->child;
-		}
-
-		current->child = header;
-		header->parent = current;
-	}
-#endif
-
-	total_allocated += size;
-	num_allocations += 1;
+	Debug_Counter_Shard& shard = get_debug_shard();
+	ch::atomic_fetch_add(&shard.total_allocated, allocation_size);
+	ch::atomic_fetch_add(&shard.num_allocations, 1);
 
 	return result;
 }
@@ -58,34 +178,26 @@ void* ch::debug_realloc(void* ptr, usize size, const char* file, u64 line) {
 	const usize old_size = old_header->size + sizeof(Allocation_Header);
 	const usize allocation_size = size + sizeof(Allocation_Header);
 	u8* result = (u8*)ch::realloc(old_header, allocation_size);
+	if (!result) return nullptr;
 
 	Allocation_Header* header = (Allocation_Header*)result;
 	result += sizeof(Allocation_Header);
 
-	*header = {};
-	header->allocation = result;
 	header->size = size;
 	header->file = file;
 	header->line = line;
 
-#if 0
-	Allocation_Header *child = header->child;
-	Allocation_Header *parent = header->parent;
-	if (child) {
-		assert(child->parent == old_header);
-		child->parent = header;
-	}
-	
-	if (parent) {
-		assert(parent->child == old_header);
-		parent->child = header;
-	} else {
-		assert(old_header == first_header);
-		first_header = header;
+	// The slot belongs to this allocation until it's freed so nobody else is going to touch it
+	if (header->slot != untracked_slot) {
+		Debug_Live_Slot& it = debug_registry[header->slot];
+		it.size = size;
+		it.file = file;
+		it.line = line;
+		ch::atomic_store(&it.allocation, (void*)result);
 	}
-#endif
 
-	total_allocated += allocation_size - old_size;
+	Debug_Counter_Shard& shard = get_debug_shard();
+	ch::atomic_fetch_add(&shard.total_allocated, allocation_size - old_size);
 	return result;
 }
 
@@ -93,70 +205,852 @@ void ch::debug_free(void* ptr) {
 	if (!ptr) return;
 
 	Allocation_Header* header = (Allocation_Header*)((u8*)ptr - sizeof(Allocation_Header));
+	untrack_allocation(header->slot);
 
-	total_allocated -= header->size + sizeof(Allocation_Header);
-	num_allocations -= 1;
-
-#if 0
-	Allocation_Header* child = header->child;
-	Allocation_Header* parent = header->parent;
-	if (child) {
-		assert(child->parent == header);
-		if (parent) {
-			assert(first_header != header);
-			parent->child = child;
-			child->parent = parent;
-		} else {
-			assert(first_header == header);
-			first_header = child;
-			child->parent = nullptr;
-		}
-	} else if (parent) {
-		parent->child = nullptr;
-	} else {
-		assert(first_header == header);
-		first_header = nullptr;
-	}
-#endif
+	Debug_Counter_Shard& shard = get_debug_shard();
+	ch::atomic_fetch_add(&shard.total_allocated, (u64)0 - (header->size + sizeof(Allocation_Header)));
+	ch::atomic_fetch_add(&shard.num_allocations, (u64)-1);
 
 	ch::free(header);
 }
 
 usize ch::get_total_allocated() {
-	return total_allocated;
+	// @NOTE(CHall): Individual shards can wrap below zero when memory is freed on a different thread. The sum won't.
+	u64 result = 0;
+	for (const Debug_Counter_Shard& it : debug_shards) {
+		result += ch::atomic_load(&it.total_allocated);
+	}
+	return (usize)result;
 }
 
 usize ch::get_num_allocations() {
-	return num_allocations;
+	u64 result = 0;
+	for (const Debug_Counter_Shard& it : debug_shards) {
+		result += ch::atomic_load(&it.num_allocations);
+	}
+	return (usize)result;
+}
+
+usize ch::get_num_untracked_allocations() {
+	return (usize)ch::atomic_load(&debug_num_untracked);
+}
+
+static bool same_allocation_site(const ch::Allocation_Site& a, const char* file, u64 line) {
+	if (a.line != line) return false;
+	if (a.file == file) return true;
+	if (!a.file || !file) return false;
+
+	usize i = 0;
+	for (; a.file[i] && a.file[i] == file[i]; i++) {}
+	return a.file[i] == file[i];
+}
+
+usize ch::get_live_allocation_sites(ch::Allocation_Site* out_sites, usize max_sites) {
+	Debug_Live_Slot* registry = ch::atomic_load(&debug_registry);
+	if (!registry || !max_sites) return 0;
+
+	// Group everything into a scratch table first. This goes straight to the os so the report doesn't show up in itself.
+	usize table_size = 1 << 14;
+	while (table_size < max_sites * 2) table_size <<= 1;
+	ch::Allocation_Site* table = (ch::Allocation_Site*)ch::os_malloc(table_size * sizeof(ch::Allocation_Site));
+	ch::mem_zero(table, table_size * sizeof(ch::Allocation_Site));
+
+	usize num_sites = 0;
+	for (usize i = 0; i < debug_registry_size; i++) {
+		const Debug_Live_Slot& it = registry[i];
+		if (!ch::atomic_load(&it.allocation)) continue;
+
+		const char* file = it.file;
+		const u64 line = it.line;
+		const usize file_count = file ? ch::strlen(file) : 0;
+		usize index = (usize)(ch::fnv1_hash(file, file_count) ^ (line * 0x9e3779b97f4a7c15ull)) & (table_size - 1);
+
+		for (;;) {
+			ch::Allocation_Site& site = table[index];
+			if (!site.count) {
+				if (num_sites * 2 >= table_size) break;
+
+				site.file = file;
+				site.line = line;
+				num_sites += 1;
+			}
+
+			if (same_allocation_site(site, file, line)) {
+				site.bytes += it.size;
+				site.count += 1;
+				break;
+			}
+
+			index = (index + 1) & (table_size - 1);
+		}
+	}
+
+	// Biggest sites first
+	usize num_written = 0;
+	for (usize i = 0; i < table_size; i++) {
+		const ch::Allocation_Site& site = table[i];
+		if (!site.count) continue;
+
+		usize insert_index = num_written < max_sites ? num_written : max_sites;
+		while (insert_index > 0 && out_sites[insert_index - 1].bytes < site.bytes) {
+			if (insert_index < max_sites) out_sites[insert_index] = out_sites[insert_index - 1];
+			insert_index -= 1;
+		}
+
+		if (insert_index < max_sites) {
+			out_sites[insert_index] = site;
+			if (num_written < max_sites) num_written += 1;
+		}
+	}
+
+	ch::os_free(table);
+	return num_written;
+}
+
+bool ch::write_leak_report(const char* path, usize max_sites) {
+	FILE* file = fopen(path, "w");
+	if (!file) return false;
+
+	ch::Allocation_Site* sites = (ch::Allocation_Site*)ch::os_malloc(max_sites * sizeof(ch::Allocation_Site));
+	const usize num_sites = ch::get_live_allocation_sites(sites, max_sites);
+
+	fprintf(file, "live allocations: %llu (%llu bytes including headers)\n", (unsigned long long)ch::get_num_allocations(), (unsigned long long)ch::get_total_allocated());
+	fprintf(file, "untracked allocations: %llu\n\n", (unsigned long long)ch::get_num_untracked_allocations());
+	fprintf(file, "%16s %10s  site\n", "bytes", "count");
+	for (usize i = 0; i < num_sites; i++) {
+		const ch::Allocation_Site& it = sites[i];
+		fprintf(file, "%16llu %10llu  %s(%llu)\n", (unsigned long long)it.bytes, (unsigned long long)it.count, it.file ? it.file : "?", (unsigned long long)it.line);
+	}
+
+	ch::os_free(sites);
+	fclose(file);
+	return true;
+}
+#endif
+
+/**
+ * Every kernel reads all of the bytes it needs for a block before it stores that block. This means the forward kernels
+ * are safe for overlapping ranges as long as dest < src and the backward kernels as long as dest > src.
+ */
+using Mem_Copy_Func = void (*)(u8* dest, const u8* src, usize size);
+using Mem_Set_Func = void (*)(u8* dest, u8 c, usize size);
+using Mem_Compare_Func = s32 (*)(const u8* a, const u8* b, usize size);
+using Mem_Find_Func = ssize (*)(const u8* ptr, usize size, u8 c);
+
+struct Mem_Kernel_Table {
+	ch::Mem_Kernel_Type type;
+	Mem_Copy_Func copy_forward;
+	Mem_Copy_Func copy_backward;
+	Mem_Copy_Func copy_streaming;
+	Mem_Set_Func set;
+	Mem_Compare_Func compare;
+	Mem_Find_Func find_byte;
+	Mem_Find_Func find_last_byte;
+};
+
+template <typename T>
+static CH_FORCEINLINE T load_unaligned(const u8* ptr) {
+#if CH_COMPILER_MSVC
+	return *(const T*)ptr;
+#else
+	T result;
+	__builtin_memcpy(&result, ptr, sizeof(T));
+	return result;
+#endif
+}
+
+template <typename T>
+static CH_FORCEINLINE void store_unaligned(u8* ptr, T value) {
+#if CH_COMPILER_MSVC
+	*(T*)ptr = value;
+#else
+	__builtin_memcpy(ptr, &value, sizeof(T));
+#endif
+}
+
+/** Handles 0 to 16 bytes with a pair of overlapping loads. Safe for overlapping ranges in either direction. */
+static CH_FORCEINLINE void copy_small(u8* dest, const u8* src, usize size) {
+	if (size >= 8) {
+		const u64 head = load_unaligned<u64>(src);
+		const u64 tail = load_unaligned<u64>(src + size - 8);
+		store_unaligned(dest, head);
+		store_unaligned(dest + size - 8, tail);
+	} else if (size >= 4) {
+		const u32 head = load_unaligned<u32>(src);
+		const u32 tail = load_unaligned<u32>(src + size - 4);
+		store_unaligned(dest, head);
+		store_unaligned(dest + size - 4, tail);
+	} else if (size >= 2) {
+		const u16 head = load_unaligned<u16>(src);
+		const u16 tail = load_unaligned<u16>(src + size - 2);
+		store_unaligned(dest, head);
+		store_unaligned(dest + size - 2, tail);
+	} else if (size) {
+		dest[0] = src[0];
+	}
+}
+
+static CH_FORCEINLINE void set_small(u8* dest, u8 c, usize size) {
+	const u64 pattern = 0x0101010101010101ull * c;
+	if (size >= 8) {
+		store_unaligned(dest, pattern);
+		store_unaligned(dest + size - 8, pattern);
+	} else if (size >= 4) {
+		store_unaligned(dest, (u32)pattern);
+		store_unaligned(dest + size - 4, (u32)pattern);
+	} else if (size >= 2) {
+		store_unaligned(dest, (u16)pattern);
+		store_unaligned(dest + size - 2, (u16)pattern);
+	} else if (size) {
+		dest[0] = c;
+	}
+}
+
+static void copy_forward_scalar(u8* dest, const u8* src, usize size) {
+	if (size <= 16) {
+		copy_small(dest, src, size);
+		return;
+	}
+
+	const u64 tail = load_unaligned<u64>(src + size - 8);
+	u8* const dest_end = dest + size - 8;
+	while (dest < dest_end) {
+		store_unaligned(dest, load_unaligned<u64>(src));
+		dest += 8;
+		src += 8;
+	}
+	store_unaligned(dest_end, tail);
+}
+
+static void copy_backward_scalar(u8* dest, const u8* src, usize size) {
+	if (size <= 16) {
+		copy_small(dest, src, size);
+		return;
+	}
+
+	const u64 head = load_unaligned<u64>(src);
+	u8* const dest_begin = dest + 8;
+	u8* d = dest + size;
+	const u8* s = src + size;
+	while (d > dest_begin) {
+		d -= 8;
+		s -= 8;
+		store_unaligned(d, load_unaligned<u64>(s));
+	}
+	store_unaligned(dest, head);
+}
+
+static void set_scalar(u8* dest, u8 c, usize size) {
+	if (size <= 16) {
+		set_small(dest, c, size);
+		return;
+	}
+
+	const u64 pattern = 0x0101010101010101ull * c;
+	u8* const dest_end = dest + size - 8;
+	while (dest < dest_end) {
+		store_unaligned(dest, pattern);
+		dest += 8;
+	}
+	store_unaligned(dest_end, pattern);
+}
+
+static s32 compare_scalar(const u8* a, const u8* b, usize size) {
+	usize i = 0;
+	for (; i + 8 <= size; i += 8) {
+		if (load_unaligned<u64>(a + i) != load_unaligned<u64>(b + i)) break;
+	}
+
+	for (; i < size; i++) {
+		if (a[i] != b[i]) return (s32)a[i] - (s32)b[i];
+	}
+
+	return 0;
+}
+
+static ssize find_byte_scalar(const u8* ptr, usize size, u8 c) {
+	for (usize i = 0; i < size; i++) {
+		if (ptr[i] == c) return (ssize)i;
+	}
+
+	return -1;
+}
+
+static ssize find_last_byte_scalar(const u8* ptr, usize size, u8 c) {
+	for (usize i = size; i > 0;) {
+		i--;
+		if (ptr[i] == c) return (ssize)i;
+	}
+
+	return -1;
+}
+
+#if CH_CPU_X86
+#include <immintrin.h>
+
+/**
+ * The SIMD kernels all work the same way. The unaligned head and tail blocks are loaded up front and stored last
+ * which lets the main loop only do aligned stores without having to care about the ragged ends.
+ */
+static void copy_forward_sse2(u8* dest, const u8* src, usize size) {
+	if (size <= 16) {
+		copy_small(dest, src, size);
+		return;
+	}
+
+	const __m128i head = _mm_loadu_si128((const __m128i*)src);
+	const __m128i tail = _mm_loadu_si128((const __m128i*)(src + size - 16));
+	u8* const dest_tail = dest + size - 16;
+
+	if (size > 32) {
+		const usize skip = 16 - ((usize)dest & 15);
+		u8* d = dest + skip;
+		const u8* s = src + skip;
+
+		while (d + 64 <= dest_tail) {
+			const __m128i a = _mm_loadu_si128((const __m128i*)(s + 0));
+			const __m128i b = _mm_loadu_si128((const __m128i*)(s + 16));
+			const __m128i c = _mm_loadu_si128((const __m128i*)(s + 32));
+			const __m128i e = _mm_loadu_si128((const __m128i*)(s + 48));
+			_mm_store_si128((__m128i*)(d + 0), a);
+			_mm_store_si128((__m128i*)(d + 16), b);
+			_mm_store_si128((__m128i*)(d + 32), c);
+			_mm_store_si128((__m128i*)(d + 48), e);
+			d += 64;
+			s += 64;
+		}
+
+		while (d < dest_tail) {
+			_mm_store_si128((__m128i*)d, _mm_loadu_si128((const __m128i*)s));
+			d += 16;
+			s += 16;
+		}
+	}
+
+	_mm_storeu_si128((__m128i*)dest, head);
+	_mm_storeu_si128((__m128i*)dest_tail, tail);
+}
+
+static void copy_backward_sse2(u8* dest, const u8* src, usize size) {
+	if (size <= 16) {
+		copy_small(dest, src, size);
+		return;
+	}
+
+	const __m128i head = _mm_loadu_si128((const __m128i*)src);
+	const __m128i tail = _mm_loadu_si128((const __m128i*)(src + size - 16));
+	u8* const dest_head_end = dest + 16;
+
+	if (size > 32) {
+		u8* d = (u8*)((usize)(dest + size - 1) & ~(usize)15);
+		const u8* s = src + (d - dest);
+
+		while (d - 64 >= dest_head_end) {
+			const __m128i a = _mm_loadu_si128((const __m128i*)(s - 16));
+			const __m128i b = _mm_loadu_si128((const __m128i*)(s - 32));
+			const __m128i c = _mm_loadu_si128((const __m128i*)(s - 48));
+			const __m128i e = _mm_loadu_si128((const __m128i*)(s - 64));
+			_mm_store_si128((__m128i*)(d - 16), a);
+			_mm_store_si128((__m128i*)(d - 32), b);
+			_mm_store_si128((__m128i*)(d - 48), c);
+			_mm_store_si128((__m128i*)(d - 64), e);
+			d -= 64;
+			s -= 64;
+		}
+
+		while (d > dest_head_end) {
+			d -= 16;
+			s -= 16;
+			_mm_store_si128((__m128i*)d, _mm_loadu_si128((const __m128i*)s));
+		}
+	}
+
+	_mm_storeu_si128((__m128i*)(dest + size - 16), tail);
+	_mm_storeu_si128((__m128i*)dest, head);
+}
+
+static void set_sse2(u8* dest, u8 c, usize size) {
+	if (size <= 16) {
+		set_small(dest, c, size);
+		return;
+	}
+
+	const __m128i v = _mm_set1_epi8((char)c);
+	u8* const dest_tail = dest + size - 16;
+	_mm_storeu_si128((__m128i*)dest, v);
+
+	u8* d = (u8*)(((usize)dest + 16) & ~(usize)15);
+	while (d + 64 <= dest_tail) {
+		_mm_store_si128((__m128i*)(d + 0), v);
+		_mm_store_si128((__m128i*)(d + 16), v);
+		_mm_store_si128((__m128i*)(d + 32), v);
+		_mm_store_si128((__m128i*)(d + 48), v);
+		d += 64;
+	}
+
+	while (d < dest_tail) {
+		_mm_store_si128((__m128i*)d, v);
+		d += 16;
+	}
+
+	_mm_storeu_si128((__m128i*)dest_tail, v);
+}
+
+/**
+ * The compare and find kernels finish with one overlapping load that ends exactly at the end of the range. The
+ * overlapped bytes were already checked so whatever the mask finds in there is still the first hit.
+ */
+static s32 compare_sse2(const u8* a, const u8* b, usize size) {
+	if (size < 16) return compare_scalar(a, b, size);
+
+	usize i = 0;
+	for (;;) {
+		const __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+		const __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+		const u32 mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) ^ 0xffff;
+		if (mask) {
+			const usize index = i + ch::count_trailing_zeros(mask);
+			return (s32)a[index] - (s32)b[index];
+		}
+
+		if (i + 16 == size) return 0;
+		i += 16;
+		if (i + 16 > size) i = size - 16;
+	}
+}
+
+static ssize find_byte_sse2(const u8* ptr, usize size, u8 c) {
+	if (size < 16) return find_byte_scalar(ptr, size, c);
+
+	const __m128i v = _mm_set1_epi8((char)c);
+	usize i = 0;
+	for (;;) {
+		const u32 mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(ptr + i)), v));
+		if (mask) return (ssize)(i + ch::count_trailing_zeros(mask));
+
+		if (i + 16 == size) return -1;
+		i += 16;
+		if (i + 16 > size) i = size - 16;
+	}
+}
+
+static ssize find_last_byte_sse2(const u8* ptr, usize size, u8 c) {
+	if (size < 16) return find_last_byte_scalar(ptr, size, c);
+
+	const __m128i v = _mm_set1_epi8((char)c);
+	usize i = size - 16;
+	for (;;) {
+		const u32 mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(ptr + i)), v));
+		if (mask) return (ssize)(i + ch::find_last_set(mask));
+
+		if (i == 0) return -1;
+		i = i >= 16 ? i - 16 : 0;
+	}
+}
+
+/**
+ * Streaming copies use non temporal stores so the destination doesn't get pulled into the cache and the source gets
+ * prefetched with the nta hint so it doesn't get left behind in the outer levels either.
+ */
+static const usize streaming_prefetch_distance = 512;
+
+static void copy_streaming_sse2(u8* dest, const u8* src, usize size) {
+	if (size <= 64) {
+		copy_forward_sse2(dest, src, size);
+		return;
+	}
+
+	const __m128i head = _mm_loadu_si128((const __m128i*)src);
+	const __m128i tail = _mm_loadu_si128((const __m128i*)(src + size - 16));
+	u8* const dest_tail = dest + size - 16;
+
+	const usize skip = 16 - ((usize)dest & 15);
+	u8* d = dest + skip;
+	const u8* s = src + skip;
+
+	while (d + 64 <= dest_tail) {
+		_mm_prefetch((const char*)(s + streaming_prefetch_distance), _MM_HINT_NTA);
+		const __m128i a = _mm_loadu_si128((const __m128i*)(s + 0));
+		const __m128i b = _mm_loadu_si128((const __m128i*)(s + 16));
+		const __m128i c = _mm_loadu_si128((const __m128i*)(s + 32));
+		const __m128i e = _mm_loadu_si128((const __m128i*)(s + 48));
+		_mm_stream_si128((__m128i*)(d + 0), a);
+		_mm_stream_si128((__m128i*)(d + 16), b);
+		_mm_stream_si128((__m128i*)(d + 32), c);
+		_mm_stream_si128((__m128i*)(d + 48), e);
+		d += 64;
+		s += 64;
+	}
+
+	while (d < dest_tail) {
+		_mm_stream_si128((__m128i*)d, _mm_loadu_si128((const __m128i*)s));
+		d += 16;
+		s += 16;
+	}
+
+	// Non temporal stores are weakly ordered so fence before anyone else can look at the memory
+	_mm_sfence();
+
+	_mm_storeu_si128((__m128i*)dest, head);
+	_mm_storeu_si128((__m128i*)dest_tail, tail);
+}
+
+CH_TARGET_AVX2 static void copy_forward_avx2(u8* dest, const u8* src, usize size) {
+	if (size <= 32) {
+		copy_forward_sse2(dest, src, size);
+		return;
+	}
+
+	const __m256i head = _mm256_loadu_si256((const __m256i*)src);
+	const __m256i tail = _mm256_loadu_si256((const __m256i*)(src + size - 32));
+	u8* const dest_tail = dest + size - 32;
+
+	if (size > 64) {
+		const usize skip = 32 - ((usize)dest & 31);
+		u8* d = dest + skip;
+		const u8* s = src + skip;
+
+		while (d + 128 <= dest_tail) {
+			const __m256i a = _mm256_loadu_si256((const __m256i*)(s + 0));
+			const __m256i b = _mm256_loadu_si256((const __m256i*)(s + 32));
+			const __m256i c = _mm256_loadu_si256((const __m256i*)(s + 64));
+			const __m256i e = _mm256_loadu_si256((const __m256i*)(s + 96));
+			_mm256_store_si256((__m256i*)(d + 0), a);
+			_mm256_store_si256((__m256i*)(d + 32), b);
+			_mm256_store_si256((__m256i*)(d + 64), c);
+			_mm256_store_si256((__m256i*)(d + 96), e);
+			d += 128;
+			s += 128;
+		}
+
+		while (d < dest_tail) {
+			_mm256_store_si256((__m256i*)d, _mm256_loadu_si256((const __m256i*)s));
+			d += 32;
+			s += 32;
+		}
+	}
+
+	_mm256_storeu_si256((__m256i*)dest, head);
+	_mm256_storeu_si256((__m256i*)dest_tail, tail);
+}
+
+CH_TARGET_AVX2 static void copy_backward_avx2(u8* dest, const u8* src, usize size) {
+	if (size <= 32) {
+		copy_backward_sse2(dest, src, size);
+		return;
+	}
+
+	const __m256i head = _mm256_loadu_si256((const __m256i*)src);
+	const __m256i tail = _mm256_loadu_si256((const __m256i*)(src + size - 32));
+	u8* const dest_head_end = dest + 32;
+
+	if (size > 64) {
+		u8* d = (u8*)((usize)(dest + size - 1) & ~(usize)31);
+		const u8* s = src + (d - dest);
+
+		while (d - 128 >= dest_head_end) {
+			const __m256i a = _mm256_loadu_si256((const __m256i*)(s - 32));
+			const __m256i b = _mm256_loadu_si256((const __m256i*)(s - 64));
+			const __m256i c = _mm256_loadu_si256((const __m256i*)(s - 96));
+			const __m256i e = _mm256_loadu_si256((const __m256i*)(s - 128));
+			_mm256_store_si256((__m256i*)(d - 32), a);
+			_mm256_store_si256((__m256i*)(d - 64), b);
+			_mm256_store_si256((__m256i*)(d - 96), c);
+			_mm256_store_si256((__m256i*)(d - 128), e);
+			d -= 128;
+			s -= 128;
+		}
+
+		while (d > dest_head_end) {
+			d -= 32;
+			s -= 32;
+			_mm256_store_si256((__m256i*)d, _mm256_loadu_si256((const __m256i*)s));
+		}
+	}
+
+	_mm256_storeu_si256((__m256i*)(dest + size - 32), tail);
+	_mm256_storeu_si256((__m256i*)dest, head);
+}
+
+CH_TARGET_AVX2 static void set_avx2(u8* dest, u8 c, usize size) {
+	if (size <= 32) {
+		set_sse2(dest, c, size);
+		return;
+	}
+
+	const __m256i v = _mm256_set1_epi8((char)c);
+	u8* const dest_tail = dest + size - 32;
+	_mm256_storeu_si256((__m256i*)dest, v);
+
+	u8* d = (u8*)(((usize)dest + 32) & ~(usize)31);
+	while (d + 128 <= dest_tail) {
+		_mm256_store_si256((__m256i*)(d + 0), v);
+		_mm256_store_si256((__m256i*)(d + 32), v);
+		_mm256_store_si256((__m256i*)(d + 64), v);
+		_mm256_store_si256((__m256i*)(d + 96), v);
+		d += 128;
+	}
+
+	while (d < dest_tail) {
+		_mm256_store_si256((__m256i*)d, v);
+		d += 32;
+	}
+
+	_mm256_storeu_si256((__m256i*)dest_tail, v);
+}
+CH_TARGET_AVX2 static s32 compare_avx2(const u8* a, const u8* b, usize size) {
+	if (size < 32) return compare_sse2(a, b, size);
+
+	usize i = 0;
+	for (;;) {
+		const __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+		const __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+		const u32 mask = ~(u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+		if (mask) {
+			const usize index = i + ch::count_trailing_zeros(mask);
+			return (s32)a[index] - (s32)b[index];
+		}
+
+		if (i + 32 == size) return 0;
+		i += 32;
+		if (i + 32 > size) i = size - 32;
+	}
+}
+
+CH_TARGET_AVX2 static ssize find_byte_avx2(const u8* ptr, usize size, u8 c) {
+	if (size < 32) return find_byte_sse2(ptr, size, c);
+
+	const __m256i v = _mm256_set1_epi8((char)c);
+	usize i = 0;
+
+	// Check two vectors per iteration and only work out which one hit once something did
+	for (; i + 64 <= size; i += 64) {
+		const __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(ptr + i)), v);
+		const __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(ptr + i + 32)), v);
+		if (!_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_or_si256(a, b))) {
+			const u32 mask_a = (u32)_mm256_movemask_epi8(a);
+			if (mask_a) return (ssize)(i + ch::count_trailing_zeros(mask_a));
+			return (ssize)(i + 32 + ch::count_trailing_zeros((u32)_mm256_movemask_epi8(b)));
+		}
+	}
+
+	if (i == size) return -1;
+	if (i + 32 > size) i = size - 32;
+	for (;;) {
+		const u32 mask = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(ptr + i)), v));
+		if (mask) return (ssize)(i + ch::count_trailing_zeros(mask));
+
+		if (i + 32 == size) return -1;
+		i += 32;
+		if (i + 32 > size) i = size - 32;
+	}
+}
+
+CH_TARGET_AVX2 static ssize find_last_byte_avx2(const u8* ptr, usize size, u8 c) {
+	if (size < 32) return find_last_byte_sse2(ptr, size, c);
+
+	const __m256i v = _mm256_set1_epi8((char)c);
+	usize i = size - 32;
+	for (;;) {
+		const u32 mask = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(ptr + i)), v));
+		if (mask) return (ssize)(i + ch::find_last_set(mask));
+
+		if (i == 0) return -1;
+		i = i >= 32 ? i - 32 : 0;
+	}
 }
 
+CH_TARGET_AVX2 static void copy_streaming_avx2(u8* dest, const u8* src, usize size) {
+	if (size <= 128) {
+		copy_forward_avx2(dest, src, size);
+		return;
+	}
+
+	const __m256i head = _mm256_loadu_si256((const __m256i*)src);
+	const __m256i tail = _mm256_loadu_si256((const __m256i*)(src + size - 32));
+	u8* const dest_tail = dest + size - 32;
+
+	const usize skip = 32 - ((usize)dest & 31);
+	u8* d = dest + skip;
+	const u8* s = src + skip;
+
+	while (d + 128 <= dest_tail) {
+		_mm_prefetch((const char*)(s + streaming_prefetch_distance), _MM_HINT_NTA);
+		_mm_prefetch((const char*)(s + streaming_prefetch_distance + 64), _MM_HINT_NTA);
+		const __m256i a = _mm256_loadu_si256((const __m256i*)(s + 0));
+		const __m256i b = _mm256_loadu_si256((const __m256i*)(s + 32));
+		const __m256i c = _mm256_loadu_si256((const __m256i*)(s + 64));
+		const __m256i e = _mm256_loadu_si256((const __m256i*)(s + 96));
+		_mm256_stream_si256((__m256i*)(d + 0), a);
+		_mm256_stream_si256((__m256i*)(d + 32), b);
+		_mm256_stream_si256((__m256i*)(d + 64), c);
+		_mm256_stream_si256((__m256i*)(d + 96), e);
+		d += 128;
+		s += 128;
+	}
+
+	while (d < dest_tail) {
+		_mm256_stream_si256((__m256i*)d, _mm256_loadu_si256((const __m256i*)s));
+		d += 32;
+		s += 32;
+	}
+
+	_mm_sfence();
+
+	_mm256_storeu_si256((__m256i*)dest, head);
+	_mm256_storeu_si256((__m256i*)dest_tail, tail);
+}
 #endif
 
+static void copy_forward_resolve(u8* dest, const u8* src, usize size);
+static void copy_backward_resolve(u8* dest, const u8* src, usize size);
+static void copy_streaming_resolve(u8* dest, const u8* src, usize size);
+static void set_resolve(u8* dest, u8 c, usize size);
+static s32 compare_resolve(const u8* a, const u8* b, usize size);
+static ssize find_byte_resolve(const u8* ptr, usize size, u8 c);
+static ssize find_last_byte_resolve(const u8* ptr, usize size, u8 c);
+
+// @NOTE(CHall): The resolve functions are plain function pointers so this is constant initialized. operator new can
+// end up calling into here before any dynamic initializers have run.
+static Mem_Kernel_Table mem_kernels = { ch::MKT_Scalar, copy_forward_resolve, copy_backward_resolve, copy_streaming_resolve, set_resolve,
+	compare_resolve, find_byte_resolve, find_last_byte_resolve };
+static bool mem_kernels_resolved = false;
+
+static void resolve_mem_kernels() {
+	if (ch::set_mem_kernel_type(ch::MKT_AVX2)) return;
+	if (ch::set_mem_kernel_type(ch::MKT_SSE2)) return;
+	ch::set_mem_kernel_type(ch::MKT_Scalar);
+}
+
+static void copy_forward_resolve(u8* dest, const u8* src, usize size) {
+	resolve_mem_kernels();
+	mem_kernels.copy_forward(dest, src, size);
+}
+
+static void copy_backward_resolve(u8* dest, const u8* src, usize size) {
+	resolve_mem_kernels();
+	mem_kernels.copy_backward(dest, src, size);
+}
+
+static void copy_streaming_resolve(u8* dest, const u8* src, usize size) {
+	resolve_mem_kernels();
+	mem_kernels.copy_streaming(dest, src, size);
+}
+
+static void set_resolve(u8* dest, u8 c, usize size) {
+	resolve_mem_kernels();
+	mem_kernels.set(dest, c, size);
+}
+
+static s32 compare_resolve(const u8* a, const u8* b, usize size) {
+	resolve_mem_kernels();
+	return mem_kernels.compare(a, b, size);
+}
+
+static ssize find_byte_resolve(const u8* ptr, usize size, u8 c) {
+	resolve_mem_kernels();
+	return mem_kernels.find_byte(ptr, size, c);
+}
+
+static ssize find_last_byte_resolve(const u8* ptr, usize size, u8 c) {
+	resolve_mem_kernels();
+	return mem_kernels.find_last_byte(ptr, size, c);
+}
+
+ch::Mem_Kernel_Type ch::get_mem_kernel_type() {
+	if (!mem_kernels_resolved) resolve_mem_kernels();
+	return mem_kernels.type;
+}
+
+bool ch::set_mem_kernel_type(ch::Mem_Kernel_Type type) {
+	Mem_Kernel_Table table = {};
+	switch (type) {
+		case ch::MKT_Scalar:
+			table = { type, copy_forward_scalar, copy_backward_scalar, copy_forward_scalar, set_scalar,
+				compare_scalar, find_byte_scalar, find_last_byte_scalar };
+			break;
+#if CH_CPU_X86
+		case ch::MKT_SSE2:
+			if (!ch::cpu_has_features(ch::CF_SSE2)) return false;
+			table = { type, copy_forward_sse2, copy_backward_sse2, copy_streaming_sse2, set_sse2,
+				compare_sse2, find_byte_sse2, find_last_byte_sse2 };
+			break;
+		case ch::MKT_AVX2:
+			if (!ch::cpu_has_features(ch::CF_AVX2)) return false;
+			table = { type, copy_forward_avx2, copy_backward_avx2, copy_streaming_avx2, set_avx2,
+				compare_avx2, find_byte_avx2, find_last_byte_avx2 };
+			break;
+#endif
+		default:
+			return false;
+	}
+
+	mem_kernels = table;
+	mem_kernels_resolved = true;
+	return true;
+}
+
+const char* ch::get_mem_kernel_name(ch::Mem_Kernel_Type type) {
+	switch (type) {
+		case ch::MKT_Scalar:
+			return "scalar";
+		case ch::MKT_SSE2:
+			return "sse2";
+		case ch::MKT_AVX2:
+			return "avx2";
+	}
+
+	return nullptr;
+}
+
+static usize mem_streaming_threshold = 8 * 1024 * 1024;
+
+usize ch::get_mem_streaming_threshold() {
+	return mem_streaming_threshold;
+}
+
+void ch::set_mem_streaming_threshold(usize size) {
+	mem_streaming_threshold = size;
+}
+
 void ch::mem_copy(void* dest, const void* src, usize size) {
-    const u8* casted_src = (u8*)src;
-    u8* casted_dest = (u8*)dest;
+	if (size >= mem_streaming_threshold) {
+		mem_kernels.copy_streaming((u8*)dest, (const u8*)src, size);
+	} else {
+		mem_kernels.copy_forward((u8*)dest, (const u8*)src, size);
+	}
+}
 
-    for (usize i = 0; i < size; i++) {
-        casted_dest[i] = casted_src[i];
-    }
+void ch::mem_copy_streaming(void* dest, const void* src, usize size) {
+	mem_kernels.copy_streaming((u8*)dest, (const u8*)src, size);
 }
 
 void* ch::mem_move(void* dest, const void* src, usize size) {
-    if (dest == src) return dest;
+	if (dest == src) return dest;
+
+	if (dest < src || (const u8*)dest >= (const u8*)src + size) {
+		mem_kernels.copy_forward((u8*)dest, (const u8*)src, size);
+	} else {
+		mem_kernels.copy_backward((u8*)dest, (const u8*)src, size);
+	}
+	return dest;
+}
 
-    if (dest < src) { 
-        ch::mem_copy(dest, src, size);
-        return dest;
-    }
-    
-    const u8* casted_src = (u8*)src;
-    u8* casted_dest = (u8*)dest;
+void ch::mem_set(void* ptr, usize size, u8 c) {
+	mem_kernels.set((u8*)ptr, c, size);
+}
 
-    for (usize i = size; i > 0;) {
-        i--;
-        casted_dest[i] = casted_src[i];
-    }
-    return dest;
+s32 ch::mem_compare(const void* a, const void* b, usize size) {
+	if (a == b) return 0;
+	return mem_kernels.compare((const u8*)a, (const u8*)b, size);
+}
+
+ssize ch::mem_find_byte(const void* ptr, usize size, u8 c) {
+	return mem_kernels.find_byte((const u8*)ptr, size, c);
+}
+
+ssize ch::mem_find_last_byte(const void* ptr, usize size, u8 c) {
+	return mem_kernels.find_last_byte((const u8*)ptr, size, c);
 }
 
 void* operator new(usize size) {
@@ -167,10 +1061,18 @@ void* operator new[](usize size) {
 	return ch_malloc(size);
 }
 
-void operator delete(void* ptr) {
+void operator delete(void* ptr) noexcept {
+	ch_free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+	ch_free(ptr);
+}
+
+void operator delete(void* ptr, usize) noexcept {
 	ch_free(ptr);
 }
 
-void operator delete[](void* ptr) {
+void operator delete[](void* ptr, usize) noexcept {
 	ch_free(ptr);
 }
\ No newline at end of file
@@ -7,6 +7,48 @@ namespace ch {
     void* realloc(void* ptr, usize size);
     void free(void* ptr);
 
+    /** Implemented per platform. Goes straight to the os heap without being seen by the heap profiler */
+    void* os_malloc(usize size);
+    void* os_realloc(void* ptr, usize size);
+    void os_free(void* ptr);
+
+    /** What the os heap says about itself. Implemented per platform. Either can be 0 if the os doesn't say */
+    void get_os_heap_usage(usize* out_bytes_in_use, usize* out_bytes_reserved);
+
+    enum Malloc_Backend {
+        MB_OS,
+        MB_Thread_Cache, // See thread_cache_allocator.h
+    };
+
+    /**
+     * Picks where ch::malloc gets new memory from. Memory from either backend can still be passed to ch::realloc and
+     * ch::free after switching so this can be set whenever. Defaults to MB_OS.
+     */
+    void set_malloc_backend(ch::Malloc_Backend backend);
+    ch::Malloc_Backend get_malloc_backend();
+
+    enum Virtual_Memory_Flags {
+        VMF_None        = 0x00,
+        VMF_Huge_Pages  = 0x01, // Only a hint. Ignored where the os can't back it transparently
+    };
+
+    /**
+     * Virtual memory
+     *
+     * Reserve a range of address space up front and commit pages in it as they're needed. Nothing in a reserved range
+     * can be touched until it's committed. Everything is in whole pages so sizes and pointers passed in get rounded out
+     * to page boundaries.
+     */
+    usize get_page_size();
+    void* reserve_memory(usize size, u32 flags = ch::VMF_None);
+    bool commit_memory(void* ptr, usize size);
+
+    /** Gives the physical pages back but keeps the address range reserved. The contents are gone after this */
+    void decommit_memory(void* ptr, usize size);
+
+    /** size has to be what was passed to reserve_memory */
+    void release_memory(void* ptr, usize size);
+
 #if CH_BUILD_DEBUG
 	void* debug_malloc(usize size, const char* file, u64 line);
 	void* debug_realloc(void* ptr, usize size, const char* file, u64 line);
@@ -14,22 +56,85 @@ namespace ch {
 
 	usize get_total_allocated();
 	usize get_num_allocations();
+
+	/** Allocations that didn't fit in the live allocation registry. They're still counted but won't show up in reports. */
+	usize get_num_untracked_allocations();
+
+	struct Allocation_Site {
+		const char* file;
+		u64 line;
+		usize bytes;
+		usize count;
+	};
+
+	/**
+	 * Groups every live allocation by the file and line it came from, biggest first
+	 *
+	 * This is a snapshot. Other threads can keep allocating while it runs so the totals might be slightly off.
+	 *
+	 * @returns number of sites written to out_sites
+	 */
+	usize get_live_allocation_sites(ch::Allocation_Site* out_sites, usize max_sites);
+	bool write_leak_report(const char* path, usize max_sites = 256);
 #endif
 
     void mem_copy(void* dest, const void* src, usize size);
+
+    /**
+     * Copies with non temporal stores so a huge copy doesn't evict everything else out of the cache
+     * 
+     * mem_copy switches to this by itself once size is at or above the streaming threshold. Only worth calling
+     * directly when you know the destination won't be touched again soon.
+     */
+    void mem_copy_streaming(void* dest, const void* src, usize size);
+    usize get_mem_streaming_threshold();
+    void set_mem_streaming_threshold(usize size);
+
     void* mem_move(void* dest, const void* src, usize size);
-    
-    CH_FORCEINLINE void mem_set(void* ptr, usize size, u8 c) {
-        u8* casted_ptr = (u8*)ptr;
+    void mem_set(void* ptr, usize size, u8 c);
+
+    /** alignment has to be a power of 2 */
+    CH_FORCEINLINE usize align_up(usize value, usize alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
 
-        for (usize i = 0; i < size; i++) {
-            casted_ptr[i] = c;
-        }
+    CH_FORCEINLINE void* align_up(void* ptr, usize alignment) {
+        return (void*)ch::align_up((usize)ptr, alignment);
+    }
+
+    CH_FORCEINLINE bool is_aligned(const void* ptr, usize alignment) {
+        return ((usize)ptr & (alignment - 1)) == 0;
     }
 
     CH_FORCEINLINE void mem_zero(void* ptr, usize size) {
         mem_set(ptr, size, 0);
     }
+
+    /** @returns < 0, 0 or > 0 depending on how the first differing byte compares. Same contract as memcmp */
+    s32 mem_compare(const void* a, const void* b, usize size);
+
+    CH_FORCEINLINE bool mem_equal(const void* a, const void* b, usize size) {
+        return mem_compare(a, b, size) == 0;
+    }
+
+    /** @returns index of the first/last byte equal to c or -1 if there isn't one */
+    ssize mem_find_byte(const void* ptr, usize size, u8 c);
+    ssize mem_find_last_byte(const void* ptr, usize size, u8 c);
+
+    /**
+     * The mem functions are backed by a table of kernels that gets picked the first time any of them are called
+     * 
+     * The best kernel the cpu supports is used by default. Setting it is mostly useful for testing and benchmarking.
+     */
+    enum Mem_Kernel_Type {
+        MKT_Scalar,
+        MKT_SSE2,
+        MKT_AVX2,
+    };
+
+    ch::Mem_Kernel_Type get_mem_kernel_type();
+    bool set_mem_kernel_type(ch::Mem_Kernel_Type type);
+    const char* get_mem_kernel_name(ch::Mem_Kernel_Type type);
 }
 
 #define ch_new new
@@ -48,5 +153,5 @@ namespace ch {
 void* operator new(usize size);
 void* operator new[](usize size);
 
-void operator delete(void* ptr);
-void operator delete[](void* ptr);
\ No newline at end of file
+void operator delete(void* ptr) noexcept;
+void operator delete[](void* ptr) noexcept;
\ No newline at end of file
@@ -0,0 +1,353 @@
+#pragma once
+
+#include "sort.h"
+#include "thread_pool.h"
+
+/**
+ * Parallel sorting
+ *
+ * ch::parallel_sort is a sample sort. A sorted random sample picks splitters that cut the range into a few buckets per
+ * worker. Blocks of the input are counted and then moved into their buckets in parallel and every bucket is sorted on
+ * its own with ch::sort. Splitters that show up more than once in the sample get a bucket of their own for elements
+ * equal to them which never needs sorting, so lots of duplicates don't pile up in one bucket.
+ *
+ * ch::parallel_radix_sort is ch::radix_sort where every pass counts and scatters a block per worker. Each block keeps
+ * its own histogram so the scatter doesn't need any atomics and it stays stable.
+ *
+ * Both need scratch memory for every element. It's only ever taken and given back on the calling thread. Small arrays
+ * and pools without threads just use the single threaded sorts.
+ */
+namespace ch {
+	namespace sort_internal {
+		const usize parallel_sort_threshold = 64 * 1024;
+		const usize buckets_per_worker = 8;
+		const usize samples_per_bucket = 16;
+
+		template <typename T, typename Compare>
+		struct Sample_Sort {
+			T* data;
+			T* buffer;
+			usize count;
+			Compare* less;
+
+			/**
+			 * Sorted with no duplicates plus a copy of the last one. Bucket i * 2 is everything between splitter i - 1 and
+			 * i and bucket i * 2 + 1 is everything equal to splitter i.
+			 */
+			T* splitters;
+			usize num_splitters;
+
+			/**
+			 * The splitters as an implicit binary search tree starting at index 1, padded out with the biggest one to
+			 * num_leaves - 1. Walking it is the same number of comparisons for everything so there's nothing to predict.
+			 */
+			T* tree;
+			usize num_leaves;
+			u32 tree_depth;
+
+			usize num_blocks;
+			usize block_size;
+
+			/** num_blocks rows of num_buckets. Counts at first then where the block's next element in that bucket goes */
+			usize* offsets;
+			usize* bucket_starts;
+
+			CH_FORCEINLINE usize get_num_buckets() const { return num_splitters * 2 + 1; }
+
+			CH_FORCEINLINE usize classify(const T& t) const {
+				usize node = 1;
+				for (u32 i = 0; i < tree_depth; i++) {
+					node = node * 2 + (usize)(*less)(tree[node], t);
+				}
+
+				// How many splitters are less than t. The padding can push it past the real ones.
+				usize index = node - num_leaves;
+				index = index < num_splitters ? index : num_splitters;
+
+				const bool equal = (index < num_splitters) & !(*less)(t, splitters[index]);
+				return index * 2 + (usize)equal;
+			}
+
+			CH_FORCEINLINE usize get_block_end(usize block) const {
+				const usize end = (block + 1) * block_size;
+				return end < count ? end : count;
+			}
+		};
+
+		/** Lays sorted out in order across the subtree at node. @returns how far it got through sorted */
+		template <typename T>
+		usize build_search_tree(T* tree, usize num_nodes, usize node, const T* sorted, usize next) {
+			if (node > num_nodes) return next;
+
+			next = build_search_tree(tree, num_nodes, node * 2, sorted, next);
+			new (tree + node) T(sorted[next]);
+			return build_search_tree(tree, num_nodes, node * 2 + 1, sorted, next + 1);
+		}
+
+		template <typename T, typename Compare>
+		void sample_sort(T* data, usize count, Compare& less, ch::Thread_Pool* pool, const ch::Allocator& scratch) {
+			ch::Allocator allocator = scratch;
+			const usize alignment = alignof(T) > ch::default_alignment ? alignof(T) : ch::default_alignment;
+			const usize num_workers = pool->get_num_workers();
+
+			Sample_Sort<T, Compare> state;
+			state.data = data;
+			state.count = count;
+			state.less = &less;
+
+			// Take a random sample, sort it and keep every samples_per_bucket'th as a splitter
+			const usize max_splitters = num_workers * buckets_per_worker - 1;
+			const usize num_samples = (max_splitters + 1) * samples_per_bucket;
+			T* samples = (T*)allocator.alloc_aligned(num_samples * sizeof(T), alignment);
+			assert(samples);
+
+			u64 rng = 0x2545f4914f6cdd1dull ^ count;
+			for (usize i = 0; i < num_samples; i++) {
+				rng ^= rng << 13;
+				rng ^= rng >> 7;
+				rng ^= rng << 17;
+				new (samples + i) T(data[rng % count]);
+			}
+			ch::sort(samples, num_samples, less);
+
+			// Room for the padding at the end of both the splitters and the tree
+			state.num_leaves = (usize)ch::round_up_pow2(max_splitters + 1);
+			const usize splitters_size = state.num_leaves * sizeof(T);
+			state.splitters = (T*)allocator.alloc_aligned(splitters_size, alignment);
+			state.tree = (T*)allocator.alloc_aligned(splitters_size, alignment);
+			assert(state.splitters && state.tree);
+
+			state.num_splitters = 0;
+			for (usize i = 1; i <= max_splitters; i++) {
+				const T& sample = samples[i * samples_per_bucket - 1];
+				if (state.num_splitters && !less(state.splitters[state.num_splitters - 1], sample)) continue;
+
+				new (state.splitters + state.num_splitters) T(sample);
+				state.num_splitters += 1;
+			}
+
+			state.num_leaves = (usize)ch::round_up_pow2(state.num_splitters + 1);
+			state.tree_depth = ch::find_last_set((u64)state.num_leaves);
+			for (usize i = state.num_splitters; i < state.num_leaves; i++) {
+				new (state.splitters + i) T(state.splitters[state.num_splitters - 1]);
+			}
+			build_search_tree(state.tree, state.num_leaves - 1, 1, state.splitters, 0);
+
+			if (!ch::is_trivially_copyable<T>::value) {
+				for (usize i = 0; i < num_samples; i++) {
+					samples[i].~T();
+				}
+			}
+			allocator.free_sized(samples, num_samples * sizeof(T), alignment);
+
+			const usize num_buckets = state.get_num_buckets();
+			state.num_blocks = num_workers * 4;
+			state.block_size = (count + state.num_blocks - 1) / state.num_blocks;
+			state.num_blocks = (count + state.block_size - 1) / state.block_size;
+
+			const usize offsets_size = state.num_blocks * num_buckets * sizeof(usize);
+			const usize bucket_starts_size = (num_buckets + 1) * sizeof(usize);
+			state.offsets = (usize*)allocator.alloc(offsets_size);
+			state.bucket_starts = (usize*)allocator.alloc(bucket_starts_size);
+			state.buffer = (T*)allocator.alloc_aligned(count * sizeof(T), alignment);
+			assert(state.offsets && state.bucket_starts && state.buffer);
+
+			ch::parallel_for(pool, state.num_blocks, [&state, num_buckets](usize block) {
+				usize* counts = state.offsets + block * num_buckets;
+				ch::mem_zero(counts, num_buckets * sizeof(usize));
+
+				const usize end = state.get_block_end(block);
+				for (usize i = block * state.block_size; i < end; i++) {
+					counts[state.classify(state.data[i])] += 1;
+				}
+			});
+
+			// Bucket major so every block's elements of a bucket land right after the block before it
+			usize offset = 0;
+			for (usize bucket = 0; bucket < num_buckets; bucket++) {
+				state.bucket_starts[bucket] = offset;
+				for (usize block = 0; block < state.num_blocks; block++) {
+					usize& it = state.offsets[block * num_buckets + bucket];
+					const usize block_count = it;
+					it = offset;
+					offset += block_count;
+				}
+			}
+			state.bucket_starts[num_buckets] = offset;
+
+			ch::parallel_for(pool, state.num_blocks, [&state, num_buckets](usize block) {
+				usize* offsets = state.offsets + block * num_buckets;
+
+				const usize end = state.get_block_end(block);
+				for (usize i = block * state.block_size; i < end; i++) {
+					T& t = state.data[i];
+					new (state.buffer + offsets[state.classify(t)]++) T(ch::move(t));
+				}
+			});
+
+			// Buckets end up exactly where they go in data so each one is sorted and moved back on its own
+			ch::parallel_for(pool, num_buckets, [&state](usize bucket) {
+				const usize start = state.bucket_starts[bucket];
+				const usize size = state.bucket_starts[bucket + 1] - start;
+				T* src = state.buffer + start;
+				if (!(bucket & 1)) ch::sort(src, size, *state.less);
+
+				T* dest = state.data + start;
+				if (ch::is_trivially_copyable<T>::value) {
+					ch::mem_copy(dest, src, size * sizeof(T));
+				} else {
+					for (usize i = 0; i < size; i++) {
+						dest[i] = ch::move(src[i]);
+						src[i].~T();
+					}
+				}
+			});
+
+			if (!ch::is_trivially_copyable<T>::value) {
+				for (usize i = 0; i < state.num_leaves; i++) {
+					state.splitters[i].~T();
+				}
+				for (usize i = 1; i < state.num_leaves; i++) {
+					state.tree[i].~T();
+				}
+			}
+
+			allocator.free_sized(state.buffer, count * sizeof(T), alignment);
+			allocator.free_sized(state.bucket_starts, bucket_starts_size);
+			allocator.free_sized(state.offsets, offsets_size);
+			allocator.free_sized(state.tree, splitters_size, alignment);
+			allocator.free_sized(state.splitters, splitters_size, alignment);
+		}
+	}
+
+	/** Same result as ch::sort. Not stable */
+	template <typename T, typename Compare>
+	void parallel_sort(T* data, usize count, Compare less, ch::Thread_Pool* pool = ch::get_thread_pool(), const ch::Allocator& scratch = ch::context_allocator) {
+		if (!pool->num_threads || count < sort_internal::parallel_sort_threshold) {
+			ch::sort(data, count, less);
+			return;
+		}
+
+		sort_internal::sample_sort(data, count, less, pool, scratch);
+	}
+
+	template <typename T>
+	void parallel_sort(T* data, usize count, ch::Thread_Pool* pool = ch::get_thread_pool(), const ch::Allocator& scratch = ch::context_allocator) {
+		ch::parallel_sort(data, count, ch::Less<T>(), pool, scratch);
+	}
+
+	/** Same result as ch::radix_sort. Stable */
+	template <typename T, typename Key_Func>
+	void parallel_radix_sort(T* data, usize count, Key_Func key, ch::Thread_Pool* pool = ch::get_thread_pool(), const ch::Allocator& scratch = ch::context_allocator) {
+		static_assert(ch::is_trivially_copyable<T>::value, "radix_sort copies elements bitwise");
+		if (!pool->num_threads || count < sort_internal::parallel_sort_threshold) {
+			ch::radix_sort(data, count, key, scratch);
+			return;
+		}
+
+		using Key = decltype(key(*data));
+		const usize num_passes = sizeof(Key);
+
+		ch::Allocator allocator = scratch;
+		const usize alignment = alignof(T) > ch::default_alignment ? alignof(T) : ch::default_alignment;
+
+		const usize num_blocks = pool->get_num_workers();
+		const usize block_size = (count + num_blocks - 1) / num_blocks;
+		auto get_block_end = [count, block_size](usize block) {
+			const usize end = (block + 1) * block_size;
+			return end < count ? end : count;
+		};
+
+		// One histogram per block for every pass. Until something moves they're all good for any pass.
+		const usize counts_size = num_blocks * num_passes * 256 * sizeof(usize);
+		usize* counts = (usize*)allocator.alloc(counts_size);
+		T* buffer = (T*)allocator.alloc_aligned(count * sizeof(T), alignment);
+		assert(counts && buffer);
+
+		ch::parallel_for(pool, num_blocks, [&](usize block) {
+			usize* block_counts = counts + block * num_passes * 256;
+			ch::mem_zero(block_counts, num_passes * 256 * sizeof(usize));
+
+			const usize end = get_block_end(block);
+			for (usize i = block * block_size; i < end; i++) {
+				const Key k = key(data[i]);
+				for (usize pass = 0; pass < num_passes; pass++) {
+					block_counts[pass * 256 + ((k >> (pass * 8)) & 0xff)] += 1;
+				}
+			}
+		});
+
+		T* src = data;
+		T* dest = buffer;
+		bool counts_current = true;
+		for (usize pass = 0; pass < num_passes; pass++) {
+			const usize shift = pass * 8;
+
+			// Skipping still works off the first counts. Moving elements around doesn't change how many of each digit there are.
+			const usize first_digit = (key(src[0]) >> shift) & 0xff;
+			usize first_digit_count = 0;
+			for (usize block = 0; block < num_blocks; block++) {
+				first_digit_count += counts[(block * num_passes + pass) * 256 + first_digit];
+			}
+			if (first_digit_count == count) continue;
+
+			if (!counts_current) {
+				ch::parallel_for(pool, num_blocks, [&](usize block) {
+					usize* block_counts = counts + (block * num_passes + pass) * 256;
+					ch::mem_zero(block_counts, 256 * sizeof(usize));
+
+					const usize end = get_block_end(block);
+					for (usize i = block * block_size; i < end; i++) {
+						block_counts[(key(src[i]) >> shift) & 0xff] += 1;
+					}
+				});
+			}
+
+			// Digit major so earlier blocks stay ahead of later ones with the same digit
+			usize offset = 0;
+			for (usize digit = 0; digit < 256; digit++) {
+				for (usize block = 0; block < num_blocks; block++) {
+					usize& it = counts[(block * num_passes + pass) * 256 + digit];
+					const usize digit_count = it;
+					it = offset;
+					offset += digit_count;
+				}
+			}
+
+			ch::parallel_for(pool, num_blocks, [&](usize block) {
+				usize* offsets = counts + (block * num_passes + pass) * 256;
+
+				const usize end = get_block_end(block);
+				for (usize i = block * block_size; i < end; i++) {
+					dest[offsets[(key(src[i]) >> shift) & 0xff]++] = src[i];
+				}
+			});
+
+			T* temp = src;
+			src = dest;
+			dest = temp;
+			counts_current = false;
+		}
+
+		if (src != data) {
+			ch::parallel_for(pool, num_blocks, [&](usize block) {
+				const usize start = block * block_size;
+				const usize end = get_block_end(block);
+				ch::mem_copy(data + start, src + start, (end - start) * sizeof(T));
+			});
+		}
+
+		allocator.free_sized(buffer, count * sizeof(T), alignment);
+		allocator.free_sized(counts, counts_size);
+	}
+
+	template <typename T>
+	void parallel_radix_sort(T* data, usize count, ch::Thread_Pool* pool = ch::get_thread_pool(), const ch::Allocator& scratch = ch::context_allocator) {
+		ch::parallel_radix_sort(data, count, ch::Radix_Key<T>(), pool, scratch);
+	}
+
+	template <typename T> void parallel_sort(ch::Array<T>& array, ch::Thread_Pool* pool = ch::get_thread_pool()) { ch::parallel_sort(array.data, array.count, pool, array.allocator); }
+	template <typename T, typename Compare> void parallel_sort(ch::Array<T>& array, Compare less, ch::Thread_Pool* pool = ch::get_thread_pool()) { ch::parallel_sort(array.data, array.count, less, pool, array.allocator); }
+	template <typename T> void parallel_radix_sort(ch::Array<T>& array, ch::Thread_Pool* pool = ch::get_thread_pool()) { ch::parallel_radix_sort(array.data, array.count, pool, array.allocator); }
+	template <typename T, typename Key_Func> void parallel_radix_sort(ch::Array<T>& array, Key_Func key, ch::Thread_Pool* pool = ch::get_thread_pool()) { ch::parallel_radix_sort(array.data, array.count, key, pool, array.allocator); }
+}
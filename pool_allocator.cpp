@@ -1,126 +1,537 @@
 #include "pool_allocator.h"
+#include "memory.h"
+#include "bits.h"
 
-static void* pool_alloc(const ch::Allocator& allocator, void* ptr, usize size) {
-	ch::Pool_Allocator_Header* header = allocator.get_header<ch::Pool_Allocator_Header>();
-
-	if (size) {
-		if (!ptr) {
-			ch::Pool_Allocator_Header* header = allocator.get_header<ch::Pool_Allocator_Header>();
-
-			ssize start_index = -1;
-			usize space_found = 0;
-			for (usize i = 0; i < header->buckets.count; i++) {
-				ch::Pool_Bucket& it = header->buckets[i];
-
-				if (!it.allocation && start_index == -1) {
-					start_index = i;
-				}
-				else if (it.allocation) {
-					start_index = -1;
-					space_found = 0;
-				}
-
-				if (start_index != -1) {
-					space_found += 1;
-				}
-
-				if ((space_found * header->bucket_size) >= size) {
-					break;
-				}
-			}
+using Pool_Header = ch::Pool_Allocator_Header;
 
-			if (start_index == -1 || (space_found * header->bucket_size) < size) return nullptr;
+const usize bits_per_word = 64;
 
-			void* allocation = (u8*)allocator.data + sizeof(*header) + (start_index * header->bucket_size);
+static CH_FORCEINLINE usize get_num_words(usize num_buckets) {
+	return (num_buckets + bits_per_word - 1) / bits_per_word;
+}
 
-			for (usize i = 0; i < space_found; i++) {
-				ch::Pool_Bucket& it = header->buckets[i + start_index];
+/** Mask of count bits starting at bit. count has to be 1 to 64 and fit in the word */
+static CH_FORCEINLINE u64 get_bit_mask(usize bit, usize count) {
+	const u64 ones = count == bits_per_word ? ~0ull : (1ull << count) - 1;
+	return ones << bit;
+}
 
-				it.allocation = allocation;
-				it.used = size > header->bucket_size ? header->bucket_size : size;
-				size -= header->bucket_size;
-			}
+static void set_buckets(ch::Pool_Chunk* chunk, usize start, usize count, bool occupied) {
+	while (count) {
+		const usize bit = start % bits_per_word;
+		const usize word_count = bits_per_word - bit < count ? bits_per_word - bit : count;
+		const u64 mask = get_bit_mask(bit, word_count);
 
-			return allocation;
+		u64& word = chunk->occupied[start / bits_per_word];
+		if (occupied) {
+			word |= mask;
 		} else {
-			usize old_size = 0;
-			bool found_allocation = false;
-			for (usize i = 0; i < header->buckets.count; i++) {
-				ch::Pool_Bucket& it = header->buckets[i];
+			word &= ~mask;
+		}
 
-				if (it.allocation == ptr) {
-					found_allocation = true;
-				}
+		start += word_count;
+		count -= word_count;
+	}
+}
 
-				if (found_allocation && it.allocation && it.allocation != ptr) {
-					break;
-				}
+static bool are_buckets_free(const ch::Pool_Chunk* chunk, usize start, usize count) {
+	if (start + count > chunk->num_buckets) return false;
 
-				it.allocation = ptr;
-				it.used = header->bucket_size;
+	while (count) {
+		const usize bit = start % bits_per_word;
+		const usize word_count = bits_per_word - bit < count ? bits_per_word - bit : count;
+		if (chunk->occupied[start / bits_per_word] & get_bit_mask(bit, word_count)) return false;
 
-				if (old_size + header->bucket_size >= size) {
-					it.used = size - old_size;
-					return it.allocation;
-				}
+		start += word_count;
+		count -= word_count;
+	}
+	return true;
+}
 
-				old_size += it.used;
-			}
+/**
+ * @returns the first bucket of a free run of count buckets whose memory is aligned or -1
+ *
+ * Runs are tracked across words so only the words with a mix of free and used buckets get scanned bit by bit. Even
+ * then it's a jump per run, never per bucket.
+ */
+static ssize find_free_run(const ch::Pool_Chunk* chunk, usize bucket_size, usize count, usize alignment) {
+	// Buckets that line up with alignment are every step buckets starting at first_aligned
+	usize first_aligned = 0;
+	usize step = 1;
+	if (bucket_size % alignment || !ch::is_aligned(chunk->memory, alignment)) {
+		usize gcd = bucket_size;
+		for (usize b = alignment; b; ) {
+			const usize t = gcd % b;
+			gcd = b;
+			b = t;
+		}
+		step = alignment / gcd;
 
-			assert(old_size < size);
+		while (first_aligned < step && !ch::is_aligned(chunk->memory + first_aligned * bucket_size, alignment)) {
+			first_aligned += 1;
+		}
+		if (first_aligned == step) return -1;
+	}
 
-			void* result = pool_alloc(allocator, nullptr, size);
-			ch::mem_copy(result, ptr, old_size);
-			pool_alloc(allocator, ptr, 0); // free
-			return result;
+	usize run_start = 0;
+	usize run_length = 0;
+	auto fits = [&]() -> ssize {
+		usize start = run_start;
+		if (start < first_aligned) {
+			start = first_aligned;
+		} else if (step > 1) {
+			start = first_aligned + (start - first_aligned + step - 1) / step * step;
 		}
-	} else if (ptr) {
-		bool found_allocation = false;
-		for (ch::Pool_Bucket& it : header->buckets) {
-			if (it.allocation == ptr) {
-				found_allocation = true;
-			}
+		if (run_start + run_length >= start + count) return (ssize)start;
+		return -1;
+	};
+
+	const usize num_words = get_num_words(chunk->num_buckets);
+	for (usize i = 0; i < num_words; i++) {
+		const u64 free = ~chunk->occupied[i];
 
-			if (found_allocation && it.allocation != ptr) break;;
+		if (free == ~0ull) {
+			if (!run_length) run_start = i * bits_per_word;
+			run_length += bits_per_word;
 
-			if (found_allocation) {
-				it.allocation = nullptr;
-				it.used = 0;
+			const ssize result = fits();
+			if (result != -1) return result;
+			continue;
+		}
+
+		usize bit = 0;
+		while (bit < bits_per_word) {
+			const u64 rest = free >> bit;
+			if (!rest) {
+				run_length = 0;
+				break;
 			}
+
+			// Skip whatever is in use and then take every free bucket in a row
+			const usize used = ch::count_trailing_zeros(rest);
+			if (used) run_length = 0;
+			bit += used;
+			if (!run_length) run_start = i * bits_per_word + bit;
+
+			const usize num_free = ch::count_trailing_zeros(~(free >> bit));
+			run_length += num_free;
+			bit += num_free;
+
+			const ssize result = fits();
+			if (result != -1) return result;
 		}
 	}
 
+	return -1;
+}
+
+/** Bytes a chunk and everything it owns need when they're laid out back to back */
+static usize get_chunk_size(usize bucket_size, usize num_buckets) {
+	usize result = sizeof(ch::Pool_Chunk);
+	result += get_num_words(num_buckets) * sizeof(u64);
+	result += num_buckets * sizeof(u32);
+	return result + ch::pool_memory_alignment + bucket_size * num_buckets;
+}
+
+static ch::Pool_Chunk* init_chunk(u8* data, usize num_buckets) {
+	ch::Pool_Chunk* chunk = (ch::Pool_Chunk*)data;
+	*chunk = {};
+	chunk->num_buckets = num_buckets;
+
+	const usize num_words = get_num_words(num_buckets);
+	chunk->occupied = (u64*)(data + sizeof(ch::Pool_Chunk));
+	chunk->run_lengths = (u32*)(chunk->occupied + num_words);
+	chunk->memory = (u8*)ch::align_up(chunk->run_lengths + num_buckets, ch::pool_memory_alignment);
+
+	ch::mem_zero(chunk->occupied, num_words * sizeof(u64));
+	ch::mem_zero(chunk->run_lengths, num_buckets * sizeof(u32));
+
+	const usize padding = num_words * bits_per_word - num_buckets;
+	if (padding) chunk->occupied[num_words - 1] = ~0ull << (bits_per_word - padding);
+
+	return chunk;
+}
+
+static ch::Pool_Chunk* find_chunk(const Pool_Header* header, void* ptr) {
+	for (ch::Pool_Chunk* it = header->chunks; it; it = it->next) {
+		if (ptr >= it->memory && ptr < it->memory + it->num_buckets * header->bucket_size) return it;
+	}
+
 	return nullptr;
 }
 
-ch::Allocator ch::make_pool_allocator(usize bucket_size, usize num_buckets) {
+/** Only chunks added by growing. The first one came with the header */
+static void free_chunk(Pool_Header* header, ch::Pool_Chunk* chunk) {
+	assert(chunk != header->chunks);
+
+	ch::Pool_Chunk* prev = header->chunks;
+	while (prev->next != chunk) {
+		prev = prev->next;
+	}
+	prev->next = chunk->next;
+	header->num_chunks -= 1;
+	ch_free(chunk);
+}
+
+static CH_FORCEINLINE void add_used_buckets(Pool_Header* header, usize count) {
+	header->used_buckets += count;
+	if (header->used_buckets > header->peak_used_buckets) header->peak_used_buckets = header->used_buckets;
+}
+
+static void* alloc_run(Pool_Header* header, ch::Pool_Chunk* chunk, usize count, usize alignment) {
+	const ssize start = find_free_run(chunk, header->bucket_size, count, alignment);
+	if (start == -1) return nullptr;
+
+	set_buckets(chunk, start, count, true);
+	chunk->run_lengths[start] = (u32)count;
+	chunk->num_used_buckets += count;
+
+	header->num_allocations += 1;
+	header->total_allocations += 1;
+	add_used_buckets(header, count);
+	return chunk->memory + start * header->bucket_size;
+}
+
+static void* pool_alloc(const ch::Allocator& allocator, void* ptr, usize old_size, usize size, usize alignment) {
+	Pool_Header* header = allocator.get_header<Pool_Header>();
+	const usize count = (size + header->bucket_size - 1) / header->bucket_size;
+
+	if (!ptr) {
+		if (!size) return nullptr;
+
+		ch::Pool_Chunk* last = nullptr;
+		for (ch::Pool_Chunk* it = header->chunks; it; it = it->next) {
+			void* result = alloc_run(header, it, count, alignment);
+			if (result) return result;
+			last = it;
+		}
+
+		if (!header->grow) {
+			header->num_failed_allocations += 1;
+			return nullptr;
+		}
+
+		// New chunks are as big as the first one unless this allocation needs more. Over aligned runs might have to
+		// skip up to alignment buckets to find one that lines up.
+		usize num_buckets = header->chunks->num_buckets;
+		const usize needed = count + (alignment > ch::pool_memory_alignment ? alignment : 0);
+		if (num_buckets < needed) num_buckets = needed;
+
+		u8* data = (u8*)ch_malloc(get_chunk_size(header->bucket_size, num_buckets));
+		if (!data) {
+			header->num_failed_allocations += 1;
+			return nullptr;
+		}
+		last->next = init_chunk(data, num_buckets);
+		header->num_chunks += 1;
+
+		void* result = alloc_run(header, last->next, count, alignment);
+		if (!result) header->num_failed_allocations += 1;
+		return result;
+	}
+
+	ch::Pool_Chunk* chunk = find_chunk(header, ptr);
+	assert(chunk);
+
+	const usize start = ((u8*)ptr - chunk->memory) / header->bucket_size;
+	const usize old_count = chunk->run_lengths[start];
+#if CH_BUILD_DEBUG
+	assert(!old_size || (old_size + header->bucket_size - 1) / header->bucket_size == old_count);
+#endif
+
+	if (!size) {
+		set_buckets(chunk, start, old_count, false);
+		chunk->run_lengths[start] = 0;
+		chunk->num_used_buckets -= old_count;
+		header->num_allocations -= 1;
+		header->used_buckets -= old_count;
+
+		if (!chunk->num_used_buckets && chunk != header->chunks) free_chunk(header, chunk);
+		return nullptr;
+	}
+
+	// Shrinking gives the tail back and growing takes the buckets right after if they're free
+	if (count <= old_count) {
+		set_buckets(chunk, start + count, old_count - count, false);
+		chunk->run_lengths[start] = (u32)count;
+		chunk->num_used_buckets -= old_count - count;
+		header->used_buckets -= old_count - count;
+		return ptr;
+	}
+
+	if (are_buckets_free(chunk, start + old_count, count - old_count)) {
+		set_buckets(chunk, start + old_count, count - old_count, true);
+		chunk->run_lengths[start] = (u32)count;
+		chunk->num_used_buckets += count - old_count;
+		add_used_buckets(header, count - old_count);
+		return ptr;
+	}
+
+	void* result = pool_alloc(allocator, nullptr, 0, size, alignment);
+	if (!result) return nullptr;
+
+	ch::mem_copy(result, ptr, old_size ? old_size : old_count * header->bucket_size);
+	pool_alloc(allocator, ptr, 0, 0, alignment); // free
+	return result;
+}
+
+usize ch::Pool_Allocator_Header::get_num_buckets() const {
+	usize result = 0;
+	for (const ch::Pool_Chunk* it = chunks; it; it = it->next) {
+		result += it->num_buckets;
+	}
+	return result;
+}
+
+usize ch::Pool_Allocator_Header::get_num_used_buckets() const {
+	usize result = 0;
+	for (const ch::Pool_Chunk* it = chunks; it; it = it->next) {
+		const usize num_words = get_num_words(it->num_buckets);
+		for (usize i = 0; i < num_words; i++) {
+			result += ch::count_set_bits(it->occupied[i]);
+		}
+
+		// The padding past the last bucket is always set
+		result -= num_words * bits_per_word - it->num_buckets;
+	}
+	return result;
+}
+
+/** Longest run of free buckets in a chunk. Same word at a time walk as find_free_run */
+static usize get_largest_free_run(const ch::Pool_Chunk* chunk) {
+	usize result = 0;
+	usize run_length = 0;
+
+	const usize num_words = get_num_words(chunk->num_buckets);
+	for (usize i = 0; i < num_words; i++) {
+		const u64 free = ~chunk->occupied[i];
+		if (free == ~0ull) {
+			run_length += bits_per_word;
+			continue;
+		}
+
+		usize bit = 0;
+		while (bit < bits_per_word) {
+			const u64 rest = free >> bit;
+			if (!rest) {
+				if (run_length > result) result = run_length;
+				run_length = 0;
+				break;
+			}
+
+			const usize used = ch::count_trailing_zeros(rest);
+			if (used) {
+				if (run_length > result) result = run_length;
+				run_length = 0;
+			}
+			bit += used;
+
+			const usize num_free = ch::count_trailing_zeros(~(free >> bit));
+			run_length += num_free;
+			bit += num_free;
+		}
+	}
+
+	return run_length > result ? run_length : result;
+}
+
+static ch::Allocator_Stats pool_stats(const ch::Allocator& allocator) {
+	const Pool_Header* header = allocator.get_header<Pool_Header>();
+
+	ch::Allocator_Stats result = {};
+	result.bytes_in_use = header->used_buckets * header->bucket_size;
+	result.peak_bytes_in_use = header->peak_used_buckets * header->bucket_size;
+	result.num_allocations = header->num_allocations;
+	result.total_allocations = header->total_allocations;
+	result.num_failed_allocations = header->num_failed_allocations;
+
+	usize num_buckets = 0;
+	usize largest_free_run = 0;
+	for (const ch::Pool_Chunk* it = header->chunks; it; it = it->next) {
+		num_buckets += it->num_buckets;
+
+		const usize run = get_largest_free_run(it);
+		if (run > largest_free_run) largest_free_run = run;
+	}
+	result.bytes_reserved = num_buckets * header->bucket_size;
+
+	const usize free_buckets = num_buckets - header->used_buckets;
+	if (free_buckets) result.fragmentation = 1.f - (f32)largest_free_run / (f32)free_buckets;
+	return result;
+}
+
+ch::Allocator ch::make_pool_allocator(usize bucket_size, usize num_buckets, bool grow) {
 	assert(bucket_size);
 	assert(num_buckets);
 
-	using Header = ch::Pool_Allocator_Header;
-	u8* data = (u8*)ch_malloc(sizeof(Header) + (bucket_size * num_buckets));
+	const usize header_size = ch::align_up(sizeof(Pool_Header), alignof(ch::Pool_Chunk));
+	u8* data = (u8*)ch_malloc(header_size + get_chunk_size(bucket_size, num_buckets));
+	if (!data) return {};
 
-	Header* header = (Header*)data;
+	Pool_Header* header = (Pool_Header*)data;
 	*header = {};
-	header->buckets.allocator = ch::get_heap_allocator();
-	header->buckets.reserve(num_buckets);
-	header->buckets.count = num_buckets;
 	header->bucket_size = bucket_size;
-
-	for (ch::Pool_Bucket& it : header->buckets) {
-		it = {};
-	}
+	header->grow = grow;
+	header->chunks = init_chunk(data + header_size, num_buckets);
+	header->num_chunks = 1;
 
 	ch::Allocator result;
 	result.data = data;
 	result.func = pool_alloc;
+	result.stats_func = pool_stats;
 	return result;
 }
 
 void ch::free_pool_allocator(Allocator* allocator) {
-	ch::Pool_Allocator_Header* header = allocator->get_header<ch::Pool_Allocator_Header>();
-	header->buckets.free();
+	Pool_Header* header = allocator->get_header<Pool_Header>();
+
+	// The first chunk came with the header
+	ch::Pool_Chunk* chunk = header->chunks->next;
+	while (chunk) {
+		ch::Pool_Chunk* next = chunk->next;
+		ch_free(chunk);
+		chunk = next;
+	}
+
 	ch_free(allocator->data);
 	allocator->data = nullptr;
 }
 
+using Object_Pool_Header = ch::Object_Pool_Header;
+
+/** Sits at the start of every slab. Objects start right after it */
+struct Object_Pool_Slab {
+	Object_Pool_Slab* next;
+};
+
+const usize object_pool_slab_header_size = ch::pool_memory_alignment;
+static_assert(sizeof(Object_Pool_Slab) <= object_pool_slab_header_size, "Slab header has to keep objects aligned");
+
+static bool add_object_pool_slab(Object_Pool_Header* header) {
+	const usize slab_size = object_pool_slab_header_size + header->object_size * header->objects_per_slab;
+	u8* memory = (u8*)header->backing.alloc_aligned(slab_size, ch::pool_memory_alignment);
+	if (!memory) return false;
+
+	Object_Pool_Slab* slab = (Object_Pool_Slab*)memory;
+	slab->next = (Object_Pool_Slab*)header->slabs;
+	header->slabs = slab;
+
+	header->slab_current = memory + object_pool_slab_header_size;
+	header->slab_end = memory + slab_size;
+
+	header->stats.num_slabs += 1;
+	header->stats.capacity += header->objects_per_slab;
+	return true;
+}
+
+static void* object_pool_alloc(const ch::Allocator& allocator, void* ptr, usize old_size, usize size, usize alignment) {
+	Object_Pool_Header* header = allocator.get_header<Object_Pool_Header>();
+
+	if (!size) {
+		if (!ptr) return nullptr;
+
+		*(void**)ptr = header->free_list;
+		header->free_list = ptr;
+		header->stats.num_used -= 1;
+		return nullptr;
+	}
+
+	// @NOTE(CHall): Everything is the same size so a realloc that still fits is the only kind there is
+	assert(size <= header->object_size);
+	assert(alignment <= ch::pool_memory_alignment && header->object_size % alignment == 0);
+	if (ptr) return size <= header->object_size ? ptr : nullptr;
+	if (size > header->object_size) return nullptr;
+
+	void* result = header->free_list;
+	if (result) {
+		header->free_list = *(void**)result;
+	} else {
+		if (header->slab_current == header->slab_end && !add_object_pool_slab(header)) {
+			header->stats.num_failed_allocations += 1;
+			return nullptr;
+		}
+
+		result = header->slab_current;
+		header->slab_current += header->object_size;
+	}
+
+	header->stats.num_used += 1;
+	header->stats.total_allocations += 1;
+	if (header->stats.num_used > header->stats.high_water) header->stats.high_water = header->stats.num_used;
+	return result;
+}
+
+static ch::Allocator_Stats object_pool_stats(const ch::Allocator& allocator) {
+	const ch::Object_Pool_Stats& stats = allocator.get_header<Object_Pool_Header>()->stats;
+
+	// @NOTE(CHall): Every free object fits every allocation so there's no such thing as fragmentation here
+	ch::Allocator_Stats result = {};
+	result.bytes_in_use = stats.num_used * stats.object_size;
+	result.peak_bytes_in_use = stats.high_water * stats.object_size;
+	result.bytes_reserved = stats.capacity * stats.object_size;
+	result.num_allocations = stats.num_used;
+	result.total_allocations = stats.total_allocations;
+	result.num_failed_allocations = stats.num_failed_allocations;
+	return result;
+}
+
+ch::Allocator ch::make_object_pool_allocator(usize object_size, usize objects_per_slab, const ch::Allocator& backing) {
+	assert(object_size);
+	assert(objects_per_slab);
+
+	ch::Allocator backing_allocator = backing;
+	Object_Pool_Header* header = (Object_Pool_Header*)backing_allocator.alloc(sizeof(Object_Pool_Header));
+	if (!header) return {};
+
+	*header = {};
+	header->backing = backing;
+	header->object_size = ch::align_up(object_size, ch::default_alignment);
+	header->objects_per_slab = objects_per_slab;
+	header->stats.object_size = header->object_size;
+
+	ch::Allocator result;
+	result.data = (u8*)header;
+	result.func = object_pool_alloc;
+	result.stats_func = object_pool_stats;
+	return result;
+}
+
+void ch::free_object_pool_allocator(ch::Allocator* allocator) {
+	Object_Pool_Header* header = allocator->get_header<Object_Pool_Header>();
+	ch::Allocator backing = header->backing;
+
+	Object_Pool_Slab* slab = (Object_Pool_Slab*)header->slabs;
+	while (slab) {
+		Object_Pool_Slab* next = slab->next;
+		backing.free_aligned(slab, ch::pool_memory_alignment);
+		slab = next;
+	}
+
+	backing.free(header);
+	allocator->data = nullptr;
+}
+
+void ch::reset_object_pool_allocator(ch::Allocator* allocator) {
+	Object_Pool_Header* header = allocator->get_header<Object_Pool_Header>();
+
+	// Every slab but the newest goes on the free list. The newest just starts bumping from the top again
+	header->free_list = nullptr;
+	Object_Pool_Slab* newest = (Object_Pool_Slab*)header->slabs;
+	if (newest) {
+		for (Object_Pool_Slab* slab = newest->next; slab; slab = slab->next) {
+			u8* objects = (u8*)slab + object_pool_slab_header_size;
+			for (usize i = header->objects_per_slab; i > 0; i--) {
+				void* object = objects + (i - 1) * header->object_size;
+				*(void**)object = header->free_list;
+				header->free_list = object;
+			}
+		}
+		header->slab_current = (u8*)newest + object_pool_slab_header_size;
+	}
+
+	header->stats.num_used = 0;
+}
+
+ch::Object_Pool_Stats ch::get_object_pool_stats(const ch::Allocator& allocator) {
+	return allocator.get_header<Object_Pool_Header>()->stats;
+}
@@ -1,22 +1,97 @@
 #pragma once
 
-#include "hash_table.h"
+#include "allocator.h"
 
 namespace ch {
-	
-	struct Pool_Bucket {
-		void* allocation;
-		usize used;
+	const usize pool_memory_alignment = 64;
+
+	/**
+	 * Bucket pool
+	 *
+	 * Memory is split up front into buckets of bucket_size and every allocation takes a run of buckets next to each
+	 * other. One bit per bucket says whether it's in use so looking for a free run goes through 64 buckets at a time
+	 * with a couple of bit scans per word.
+	 *
+	 * The header, the first chunk's book keeping and its buckets are all one allocation. A pool made with grow set
+	 * chains on another chunk of at least num_buckets when nothing fits instead of failing. Those chunks are freed as
+	 * soon as everything in them is, the first one is kept for the pool's lifetime.
+	 */
+	struct Pool_Chunk {
+		Pool_Chunk* next;
+		usize num_buckets;
+		usize num_used_buckets;
+
+		/** One bit per bucket, set while it's part of an allocation. Bits past num_buckets are always set */
+		u64* occupied;
+
+		/** How many buckets the allocation starting at each bucket has. Only meaningful for the first one */
+		u32* run_lengths;
+
+		/** Aligned to pool_memory_alignment. Allocations with a bigger alignment only start on buckets that line up */
+		u8* memory;
 	};
 
 	struct Pool_Allocator_Header {
-		ch::Array<Pool_Bucket> buckets;
 		usize bucket_size;
+		bool grow;
 
-		CH_FORCEINLINE usize get_num_buckets() const { return buckets.count; }
+		/** The first one lives right after the header */
+		ch::Pool_Chunk* chunks;
+		usize num_chunks;
+
+		usize num_allocations;
+		usize total_allocations;
+		usize num_failed_allocations;
+		usize peak_used_buckets;
+		usize used_buckets;
+
+		usize get_num_buckets() const;
+		usize get_num_used_buckets() const;
 	};
 
-	ch::Allocator make_pool_allocator(usize bucket_size, usize num_buckets);
+	ch::Allocator make_pool_allocator(usize bucket_size, usize num_buckets, bool grow = false);
 	void free_pool_allocator(ch::Allocator* allocator);
 
+	/**
+	 * Object pool
+	 *
+	 * Every allocation is the same fixed size. Free objects are kept on an intrusive list threaded through the objects
+	 * themselves so alloc and free are a pointer pop and push no matter how big the pool gets. When every object is in
+	 * use a new slab is taken from the backing allocator. A fresh slab is handed out in order as the free list runs dry
+	 * so it never has to be walked up front.
+	 *
+	 * Slabs only go back to the backing allocator when the pool is freed.
+	 */
+	struct Object_Pool_Stats {
+		usize object_size;
+		usize num_slabs;
+		usize capacity;
+		usize num_used;
+		usize high_water;
+		usize total_allocations;
+		usize num_failed_allocations;
+	};
+
+	struct Object_Pool_Header {
+		ch::Allocator backing;
+		usize object_size;
+		usize objects_per_slab;
+
+		void* free_list;
+		void* slabs;
+		u8* slab_current;
+		u8* slab_end;
+
+		ch::Object_Pool_Stats stats;
+	};
+
+	/** object_size gets rounded up to default_alignment. Every object is at least that aligned */
+	ch::Allocator make_object_pool_allocator(usize object_size, usize objects_per_slab = 64, const ch::Allocator& backing = ch::get_heap_allocator());
+	void free_object_pool_allocator(ch::Allocator* allocator);
+
+	/** Every object goes back to the pool but the slabs are kept */
+	void reset_object_pool_allocator(ch::Allocator* allocator);
+
+	ch::Object_Pool_Stats get_object_pool_stats(const ch::Allocator& allocator);
+
 }
\ No newline at end of file
@@ -34,4 +34,18 @@ project "ch_stl"
 		{
 			"win32/**.h",
 			"win32/**.cpp",
+		}
+
+    filter "system:linux"
+        cppdialect "C++17"
+
+		files 
+		{
+			"linux/**.h",
+			"linux/**.cpp",
+		}
+
+		links
+		{
+			"pthread",
 		}
\ No newline at end of file
@@ -0,0 +1,335 @@
+#pragma once
+
+#include "array.h"
+
+namespace ch {
+    /**
+     * Array that keeps its first N elements inside itself
+     *
+     * Nothing touches the allocator until it grows past N. After that it works just like ch::Array and the elements
+     * stay on the heap until it's freed. Same API as ch::Array minus the custom alignment.
+     *
+     * data points into the struct while it's inline so copying one copies the inline elements. Once it's on the heap a
+     * copy shares the memory like any other container.
+     */
+    template <typename T, usize N>
+    struct Small_Array {
+        static_assert(N > 0, "Small_Array needs room for at least one element inline");
+
+        T* data;
+        usize count;
+        usize allocated;
+        ch::Allocator allocator;
+
+        alignas(T) u8 inline_data[N * sizeof(T)];
+
+        Small_Array(const ch::Allocator& in_alloc = ch::context_allocator) : data(get_inline_data()), count(0), allocated(N), allocator(in_alloc) {}
+
+        Small_Array(std::initializer_list<T> init_list, const ch::Allocator& in_alloc = ch::context_allocator)
+            : data(get_inline_data()), count(0), allocated(N), allocator(in_alloc) {
+            if (init_list.size() > N) reserve(init_list.size() - N);
+            for (const T& item : init_list) {
+                new (data + count) T(item);
+                count += 1;
+            }
+        }
+
+        explicit Small_Array(usize amount, const ch::Allocator& in_alloc = ch::context_allocator)
+            : data(get_inline_data()), count(0), allocated(N), allocator(in_alloc) {
+            if (amount > N) reserve(amount - N);
+        }
+
+        Small_Array(const Small_Array<T, N>& other) {
+            *this = other;
+        }
+
+        Small_Array<T, N>& operator=(const Small_Array<T, N>& other) {
+            if (this == &other) return *this;
+
+            allocator = other.allocator;
+            count = other.count;
+            allocated = other.allocated;
+            data = other.data;
+
+            if (other.is_inline()) {
+                data = get_inline_data();
+                if (ch::is_trivially_copyable<T>::value) {
+                    ch::mem_copy(data, other.data, count * sizeof(T));
+                } else {
+                    for (usize i = 0; i < count; i++) {
+                        new (data + i) T(other.data[i]);
+                    }
+                }
+            }
+            return *this;
+        }
+
+        Small_Array<T, N> copy(const ch::Allocator& in_alloc = ch::context_allocator) const {
+            Small_Array<T, N> result(in_alloc);
+            if (count > N) result.reserve(count - N);
+            result.count = count;
+            if (ch::is_trivially_copyable<T>::value) {
+                ch::mem_copy(result.data, data, count * sizeof(T));
+            } else {
+                for (usize i = 0; i < count; i++) {
+                    new (result.data + i) T(data[i]);
+                }
+            }
+            return result;
+        }
+
+        /** Gives the heap memory back if there is any and goes back to the inline storage */
+        void free() {
+            if (!is_inline()) {
+                assert(allocator);
+                allocator.free_sized(data, allocated * sizeof(T), get_alignment());
+            }
+            data = get_inline_data();
+            count = 0;
+            allocated = N;
+        }
+
+        CH_FORCEINLINE T* get_inline_data() {
+            return (T*)inline_data;
+        }
+
+        CH_FORCEINLINE const T* get_inline_data() const {
+            return (const T*)inline_data;
+        }
+
+        CH_FORCEINLINE bool is_inline() const {
+            return data == get_inline_data();
+        }
+
+        T* begin() {
+            return data;
+        }
+
+        T* end() {
+            return data + count;
+        }
+
+        const T* cbegin() const {
+            return data;
+        }
+
+        const T* cend() const {
+            return data + count;
+        }
+
+        operator bool() const { return count > 0; }
+
+        usize get_alignment() const {
+            return alignof(T) > ch::default_alignment ? alignof(T) : ch::default_alignment;
+        }
+
+        T& operator[](usize index) {
+            assert(index < count);
+            return data[index];
+        }
+
+        const T& operator[](usize index) const {
+            assert(index < count);
+            return data[index];
+        }
+
+        bool operator==(const Small_Array<T, N>& right) const {
+            if (count != right.count) return false;
+
+            if (ch::is_bitwise_comparable<T>::value) {
+                return ch::mem_equal(data, right.data, count * sizeof(T));
+            }
+
+            for (usize i = 0; i < count; i++) {
+                if (data[i] != right[i]) return false;
+            }
+
+            return true;
+        }
+
+        bool operator!=(const Small_Array<T, N>& right) const {
+            return !(*this == right);
+        }
+
+        void reserve(usize size) {
+            const usize old_allocated = allocated;
+            usize new_count = allocated + size;
+            while (allocated < new_count) {
+                allocated += allocated >> 1;
+                allocated += 1;
+            }
+
+            if (is_inline()) {
+                T* new_data = (T*)allocator.alloc_aligned(allocated * sizeof(T), get_alignment());
+                ch::relocate(new_data, data, count);
+                data = new_data;
+            } else if (ch::is_trivially_relocatable<T>::value) {
+                data = (T*)allocator.realloc_sized(data, old_allocated * sizeof(T), allocated * sizeof(T), get_alignment());
+            } else {
+                T* new_data = (T*)allocator.alloc_aligned(allocated * sizeof(T), get_alignment());
+                ch::relocate(new_data, data, count);
+                allocator.free_sized(data, old_allocated * sizeof(T), get_alignment());
+                data = new_data;
+            }
+        }
+
+        T& front() {
+            return data[0];
+        }
+
+        const T& front() const {
+            return data[0];
+        }
+
+        T& back() {
+            return data[count - 1];
+        }
+
+        const T& back() const {
+            return data[count - 1];
+        }
+
+        usize push(const T& t) {
+            const usize old_count = count;
+            insert(t, count);
+            return old_count;
+        }
+
+        usize push(T&& t) {
+            const usize old_count = count;
+            insert(ch::move(t), count);
+            return old_count;
+        }
+
+        template <typename... Args>
+        T& emplace(Args&&... args) {
+            T* result = make_room(count);
+            new (result) T(ch::forward<Args>(args)...);
+            count += 1;
+            return *result;
+        }
+
+        usize push_empty() {
+            const usize old_count = count;
+            insert_zero(count);
+            return old_count;
+        }
+
+        void pop() {
+            count -= 1;
+        }
+
+        void remove(usize index) {
+            assert(index < count);
+            ch::relocate(data + index, data + index + 1, count - index - 1);
+            count -= 1;
+        }
+
+        void insert(const T& t, usize index) {
+            if (&t >= data && &t < data + count) {
+                T temp(t);
+                new (make_room(index)) T(ch::move(temp));
+            } else {
+                new (make_room(index)) T(t);
+            }
+            count += 1;
+        }
+
+        void insert(T&& t, usize index) {
+            if (&t >= data && &t < data + count) {
+                T temp(ch::move(t));
+                new (make_room(index)) T(ch::move(temp));
+            } else {
+                new (make_room(index)) T(ch::move(t));
+            }
+            count += 1;
+        }
+
+        void insert_zero(usize index) {
+            ch::mem_zero(make_room(index), sizeof(T));
+            count += 1;
+        }
+
+        usize push_range(const T* items, usize num) {
+            const usize old_count = count;
+            insert_range(items, num, count);
+            return old_count;
+        }
+
+        void insert_range(const T* items, usize num, usize index) {
+            assert(items + num <= data || items >= data + allocated);
+            if (!num) return;
+
+            T* dest = make_room(index, num);
+            if (ch::is_trivially_copyable<T>::value) {
+                ch::mem_copy(dest, items, num * sizeof(T));
+            } else {
+                for (usize i = 0; i < num; i++) {
+                    new (dest + i) T(items[i]);
+                }
+            }
+            count += num;
+        }
+
+        void remove_range(usize index, usize num) {
+            assert(index + num <= count);
+            ch::relocate(data + index, data + index + num, count - index - num);
+            count -= num;
+        }
+
+        void remove_swap(usize index) {
+            assert(index < count);
+            count -= 1;
+            if (index != count) ch::relocate(data + index, data + count, 1);
+        }
+
+        template <typename Predicate>
+        usize remove_if(Predicate pred) {
+            usize kept = 0;
+            for (usize i = 0; i < count; i++) {
+                if (pred(data[i])) continue;
+
+                if (kept != i) {
+                    if (ch::is_trivially_copyable<T>::value) {
+                        data[kept] = data[i];
+                    } else {
+                        ch::relocate(data + kept, data + i, 1);
+                    }
+                }
+                kept += 1;
+            }
+
+            const usize removed = count - kept;
+            count = kept;
+            return removed;
+        }
+
+        T* make_room(usize index, usize num = 1) {
+            assert(index <= count);
+            if (count + num > allocated) {
+                reserve(count + num - allocated);
+            }
+
+            ch::relocate(data + index + num, data + index, count - index);
+            return data + index;
+        }
+
+        ssize find(const T& t) const {
+            if (ch::is_bitwise_comparable<T>::value && sizeof(T) == 1) {
+                return ch::mem_find_byte(data, count, *(const u8*)&t);
+            }
+
+            for (usize i = 0; i < count; i++) {
+                if (data[i] == t) {
+                    return i;
+                }
+            }
+
+            return -1;
+        }
+
+        bool contains(const T& t) const {
+            return find(t) != -1;
+        }
+    };
+}
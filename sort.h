@@ -0,0 +1,708 @@
+#pragma once
+
+#include "small_array.h"
+#include "bits.h"
+
+/**
+ * Sorting
+ *
+ * ch::sort is pattern defeating quicksort. It's an introsort that falls back to insertion sort on small ranges and to
+ * heapsort when it keeps picking bad pivots. It also finds already sorted runs and runs of equal elements and gets
+ * through those in linear time. With the default comparator on plain numbers it partitions in blocks without branching
+ * on the comparisons.
+ *
+ * ch::stable_sort is a merge sort that needs scratch memory for half the elements. ch::radix_sort is an LSD radix sort
+ * for anything that can be reduced to an unsigned integer key. It's stable and needs scratch memory for all of them.
+ */
+namespace ch {
+	template <typename T>
+	struct Less {
+		CH_FORCEINLINE bool operator()(const T& a, const T& b) const { return a < b; }
+	};
+
+	template <typename T>
+	struct Greater {
+		CH_FORCEINLINE bool operator()(const T& a, const T& b) const { return b < a; }
+	};
+
+	namespace sort_internal {
+		const usize insertion_sort_threshold = 24;
+		const usize ninther_threshold = 128;
+		const usize partial_insertion_sort_limit = 8;
+		const usize block_size = 64;
+
+		/** Numbers where a < b is a single instruction and moving one is a register copy */
+		template <typename T> struct is_branchless_friendly { static const bool value = ch::is_bitwise_comparable<T>::value; };
+		template <> struct is_branchless_friendly<f32> { static const bool value = true; };
+		template <> struct is_branchless_friendly<f64> { static const bool value = true; };
+
+		template <typename T, typename Compare> struct use_branchless { static const bool value = false; };
+		template <typename T> struct use_branchless<T, ch::Less<T>> { static const bool value = is_branchless_friendly<T>::value; };
+
+		template <typename T, typename Compare>
+		void insertion_sort(T* begin, T* end, Compare& less) {
+			if (begin == end) return;
+
+			for (T* it = begin + 1; it != end; it++) {
+				if (!less(*it, it[-1])) continue;
+
+				T temp(ch::move(*it));
+				T* hole = it;
+				do {
+					*hole = ch::move(hole[-1]);
+					hole -= 1;
+				} while (hole != begin && less(temp, hole[-1]));
+				*hole = ch::move(temp);
+			}
+		}
+
+		/** Same as insertion_sort but the element right before begin has to be no bigger than anything in the range */
+		template <typename T, typename Compare>
+		void unguarded_insertion_sort(T* begin, T* end, Compare& less) {
+			if (begin == end) return;
+
+			for (T* it = begin + 1; it != end; it++) {
+				if (!less(*it, it[-1])) continue;
+
+				T temp(ch::move(*it));
+				T* hole = it;
+				do {
+					*hole = ch::move(hole[-1]);
+					hole -= 1;
+				} while (less(temp, hole[-1]));
+				*hole = ch::move(temp);
+			}
+		}
+
+		/** Insertion sort that gives up once it's had to move more than a few elements. @returns true if it finished */
+		template <typename T, typename Compare>
+		bool partial_insertion_sort(T* begin, T* end, Compare& less) {
+			if (begin == end) return true;
+
+			usize moved = 0;
+			for (T* it = begin + 1; it != end; it++) {
+				if (!less(*it, it[-1])) continue;
+
+				T temp(ch::move(*it));
+				T* hole = it;
+				do {
+					*hole = ch::move(hole[-1]);
+					hole -= 1;
+				} while (hole != begin && less(temp, hole[-1]));
+				*hole = ch::move(temp);
+
+				moved += it - hole;
+				if (moved > partial_insertion_sort_limit) return it + 1 == end;
+			}
+
+			return true;
+		}
+
+		template <typename T, typename Compare>
+		CH_FORCEINLINE void sort2(T* a, T* b, Compare& less) {
+			if (less(*b, *a)) ch::swap(*a, *b);
+		}
+
+		template <typename T, typename Compare>
+		CH_FORCEINLINE void sort3(T* a, T* b, T* c, Compare& less) {
+			sort2(a, b, less);
+			sort2(b, c, less);
+			sort2(a, b, less);
+		}
+
+		/** Puts the median of a few elements at begin so it can be used as the pivot */
+		template <typename T, typename Compare>
+		void choose_pivot(T* begin, T* end, Compare& less) {
+			const usize size = end - begin;
+			const usize half = size / 2;
+			if (size > ninther_threshold) {
+				sort3(begin, begin + half, end - 1, less);
+				sort3(begin + 1, begin + (half - 1), end - 2, less);
+				sort3(begin + 2, begin + (half + 1), end - 3, less);
+				sort3(begin + (half - 1), begin + half, begin + (half + 1), less);
+				ch::swap(*begin, begin[half]);
+			} else {
+				sort3(begin + half, begin, end - 1, less);
+			}
+		}
+
+		template <typename T, typename Compare>
+		void sift_down(T* heap, usize size, usize index, Compare& less) {
+			T value(ch::move(heap[index]));
+			while (true) {
+				usize child = index * 2 + 1;
+				if (child >= size) break;
+				if (child + 1 < size && less(heap[child], heap[child + 1])) child += 1;
+				if (!less(value, heap[child])) break;
+
+				heap[index] = ch::move(heap[child]);
+				index = child;
+			}
+			heap[index] = ch::move(value);
+		}
+
+		template <typename T, typename Compare>
+		void heap_sort(T* begin, T* end, Compare& less) {
+			const usize size = end - begin;
+			if (size < 2) return;
+
+			for (usize i = size / 2; i > 0; i--) {
+				sift_down(begin, size, i - 1, less);
+			}
+
+			for (usize i = size - 1; i > 0; i--) {
+				ch::swap(begin[0], begin[i]);
+				sift_down(begin, i, 0, less);
+			}
+		}
+
+		template <typename T>
+		struct Partition_Result {
+			T* pivot;
+			bool already_partitioned;
+		};
+
+		/**
+		 * Partitions around *begin. Elements equal to the pivot go to the right.
+		 *
+		 * Needs something no smaller than the pivot after the range or at least one element right of begin that isn't
+		 * less than it, which the median of 3 always gives.
+		 */
+		template <typename T, typename Compare>
+		Partition_Result<T> partition_right(T* begin, T* end, Compare& less) {
+			T pivot(ch::move(*begin));
+			T* first = begin;
+			T* last = end;
+
+			while (less(*++first, pivot));
+
+			// Nothing was less than the pivot yet so there's no guard on the right
+			if (first - 1 == begin) {
+				while (first < last && !less(*--last, pivot));
+			} else {
+				while (!less(*--last, pivot));
+			}
+
+			const bool already_partitioned = first >= last;
+			while (first < last) {
+				ch::swap(*first, *last);
+				while (less(*++first, pivot));
+				while (!less(*--last, pivot));
+			}
+
+			T* pivot_pos = first - 1;
+			*begin = ch::move(*pivot_pos);
+			*pivot_pos = ch::move(pivot);
+			return { pivot_pos, already_partitioned };
+		}
+
+		/** Swaps num pairs of wrong side elements. A cyclic permutation when it doesn't have to be pairwise swaps */
+		template <typename T>
+		CH_FORCEINLINE void swap_offsets(T* first, T* last, const u8* offsets_l, const u8* offsets_r, usize num, bool use_swaps) {
+			if (use_swaps) {
+				// Equal counts on both sides need actual swaps or the same element could end up moved twice
+				for (usize i = 0; i < num; i++) {
+					ch::swap(first[offsets_l[i]], *(last - offsets_r[i]));
+				}
+			} else if (num > 0) {
+				T* l = first + offsets_l[0];
+				T* r = last - offsets_r[0];
+				T temp(ch::move(*l));
+				*l = ch::move(*r);
+				for (usize i = 1; i < num; i++) {
+					l = first + offsets_l[i];
+					*r = ch::move(*l);
+					r = last - offsets_r[i];
+					*l = ch::move(*r);
+				}
+				*r = ch::move(temp);
+			}
+		}
+
+		/**
+		 * partition_right where comparisons only ever decide where an offset gets written, never whether code runs
+		 *
+		 * Blocks of elements on each side are scanned for ones on the wrong side and their offsets recorded. Then they're
+		 * swapped in one go. Based on BlockQuicksort by Edelkamp and Weiss.
+		 */
+		template <typename T, typename Compare>
+		Partition_Result<T> partition_right_branchless(T* begin, T* end, Compare& less) {
+			T pivot(ch::move(*begin));
+			T* first = begin;
+			T* last = end;
+
+			while (less(*++first, pivot));
+
+			if (first - 1 == begin) {
+				while (first < last && !less(*--last, pivot));
+			} else {
+				while (!less(*--last, pivot));
+			}
+
+			const bool already_partitioned = first >= last;
+			if (!already_partitioned) {
+				ch::swap(*first, *last);
+				first += 1;
+
+				alignas(64) u8 offsets_l[block_size];
+				alignas(64) u8 offsets_r[block_size];
+
+				T* offsets_l_base = first;
+				T* offsets_r_base = last;
+				usize num_l = 0;
+				usize num_r = 0;
+				usize start_l = 0;
+				usize start_r = 0;
+
+				while (first < last) {
+					// Split whatever is left between the sides that need a new block
+					const usize num_unknown = last - first;
+					const usize left_split = num_l == 0 ? (num_r == 0 ? num_unknown / 2 : num_unknown) : 0;
+					const usize right_split = num_r == 0 ? num_unknown - left_split : 0;
+
+					if (left_split >= block_size) {
+						for (usize i = 0; i < block_size;) {
+							offsets_l[num_l] = (u8)i++; num_l += !less(*first, pivot); first += 1;
+							offsets_l[num_l] = (u8)i++; num_l += !less(*first, pivot); first += 1;
+							offsets_l[num_l] = (u8)i++; num_l += !less(*first, pivot); first += 1;
+							offsets_l[num_l] = (u8)i++; num_l += !less(*first, pivot); first += 1;
+							offsets_l[num_l] = (u8)i++; num_l += !less(*first, pivot); first += 1;
+							offsets_l[num_l] = (u8)i++; num_l += !less(*first, pivot); first += 1;
+							offsets_l[num_l] = (u8)i++; num_l += !less(*first, pivot); first += 1;
+							offsets_l[num_l] = (u8)i++; num_l += !less(*first, pivot); first += 1;
+						}
+					} else {
+						for (usize i = 0; i < left_split;) {
+							offsets_l[num_l] = (u8)i++; num_l += !less(*first, pivot); first += 1;
+						}
+					}
+
+					if (right_split >= block_size) {
+						for (usize i = 0; i < block_size;) {
+							offsets_r[num_r] = (u8)++i; num_r += less(*--last, pivot);
+							offsets_r[num_r] = (u8)++i; num_r += less(*--last, pivot);
+							offsets_r[num_r] = (u8)++i; num_r += less(*--last, pivot);
+							offsets_r[num_r] = (u8)++i; num_r += less(*--last, pivot);
+							offsets_r[num_r] = (u8)++i; num_r += less(*--last, pivot);
+							offsets_r[num_r] = (u8)++i; num_r += less(*--last, pivot);
+							offsets_r[num_r] = (u8)++i; num_r += less(*--last, pivot);
+							offsets_r[num_r] = (u8)++i; num_r += less(*--last, pivot);
+						}
+					} else {
+						for (usize i = 0; i < right_split;) {
+							offsets_r[num_r] = (u8)++i; num_r += less(*--last, pivot);
+						}
+					}
+
+					const usize num = num_l < num_r ? num_l : num_r;
+					swap_offsets(offsets_l_base, offsets_r_base, offsets_l + start_l, offsets_r + start_r, num, num_l == num_r);
+					num_l -= num;
+					num_r -= num;
+					start_l += num;
+					start_r += num;
+
+					if (num_l == 0) {
+						start_l = 0;
+						offsets_l_base = first;
+					}
+
+					if (num_r == 0) {
+						start_r = 0;
+						offsets_r_base = last;
+					}
+				}
+
+				// Whatever is left on one side gets swapped into the middle
+				if (num_l) {
+					const u8* offsets = offsets_l + start_l;
+					while (num_l--) ch::swap(offsets_l_base[offsets[num_l]], *--last);
+					first = last;
+				}
+
+				if (num_r) {
+					const u8* offsets = offsets_r + start_r;
+					while (num_r--) {
+						ch::swap(*(offsets_r_base - offsets[num_r]), *first);
+						first += 1;
+					}
+					last = first;
+				}
+			}
+
+			T* pivot_pos = first - 1;
+			*begin = ch::move(*pivot_pos);
+			*pivot_pos = ch::move(pivot);
+			return { pivot_pos, already_partitioned };
+		}
+
+		/**
+		 * Partitions around *begin with elements equal to the pivot going to the left. Only used when the element before
+		 * begin is equal to the pivot so everything that ends up left of it is equal to it and already in place.
+		 */
+		template <typename T, typename Compare>
+		T* partition_left(T* begin, T* end, Compare& less) {
+			T pivot(ch::move(*begin));
+			T* first = begin;
+			T* last = end;
+
+			while (less(pivot, *--last));
+
+			if (last + 1 == end) {
+				while (first < last && !less(pivot, *++first));
+			} else {
+				while (!less(pivot, *++first));
+			}
+
+			while (first < last) {
+				ch::swap(*first, *last);
+				while (less(pivot, *--last));
+				while (!less(pivot, *++first));
+			}
+
+			T* pivot_pos = last;
+			*begin = ch::move(*pivot_pos);
+			*pivot_pos = ch::move(pivot);
+			return pivot_pos;
+		}
+
+		template <typename T, typename Compare>
+		CH_FORCEINLINE Partition_Result<T> partition(T* begin, T* end, Compare& less) {
+			if (use_branchless<T, Compare>::value) return partition_right_branchless(begin, end, less);
+			return partition_right(begin, end, less);
+		}
+
+		/** Swaps a few elements around after a bad partition so the same pattern doesn't keep picking bad pivots */
+		template <typename T>
+		void break_patterns(T* begin, T* pivot_pos, T* end) {
+			const usize l_size = pivot_pos - begin;
+			const usize r_size = end - (pivot_pos + 1);
+
+			if (l_size >= insertion_sort_threshold) {
+				ch::swap(begin[0], begin[l_size / 4]);
+				ch::swap(pivot_pos[-1], *(pivot_pos - l_size / 4));
+				if (l_size > ninther_threshold) {
+					ch::swap(begin[1], begin[l_size / 4 + 1]);
+					ch::swap(begin[2], begin[l_size / 4 + 2]);
+					ch::swap(pivot_pos[-2], *(pivot_pos - (l_size / 4 + 1)));
+					ch::swap(pivot_pos[-3], *(pivot_pos - (l_size / 4 + 2)));
+				}
+			}
+
+			if (r_size >= insertion_sort_threshold) {
+				ch::swap(pivot_pos[1], pivot_pos[1 + r_size / 4]);
+				ch::swap(end[-1], *(end - r_size / 4));
+				if (r_size > ninther_threshold) {
+					ch::swap(pivot_pos[2], pivot_pos[2 + r_size / 4]);
+					ch::swap(pivot_pos[3], pivot_pos[3 + r_size / 4]);
+					ch::swap(end[-2], *(end - (1 + r_size / 4)));
+					ch::swap(end[-3], *(end - (2 + r_size / 4)));
+				}
+			}
+		}
+
+		template <typename T, typename Compare>
+		void pdq_sort(T* begin, T* end, Compare& less, u32 bad_allowed, bool leftmost) {
+			while (true) {
+				const usize size = end - begin;
+				if (size < insertion_sort_threshold) {
+					if (leftmost) {
+						insertion_sort(begin, end, less);
+					} else {
+						unguarded_insertion_sort(begin, end, less);
+					}
+					return;
+				}
+
+				choose_pivot(begin, end, less);
+
+				// @NOTE(CHall): The pivot is equal to the element before the range so everything equal to it is done
+				if (!leftmost && !less(begin[-1], *begin)) {
+					begin = partition_left(begin, end, less) + 1;
+					continue;
+				}
+
+				const Partition_Result<T> result = partition(begin, end, less);
+				T* pivot_pos = result.pivot;
+
+				const usize l_size = pivot_pos - begin;
+				const usize r_size = end - (pivot_pos + 1);
+				if (l_size < size / 8 || r_size < size / 8) {
+					bad_allowed -= 1;
+					if (bad_allowed == 0) {
+						heap_sort(begin, end, less);
+						return;
+					}
+					break_patterns(begin, pivot_pos, end);
+				} else if (result.already_partitioned && partial_insertion_sort(begin, pivot_pos, less) && partial_insertion_sort(pivot_pos + 1, end, less)) {
+					return;
+				}
+
+				// Recurse into the left, loop on the right
+				pdq_sort(begin, pivot_pos, less, bad_allowed, leftmost);
+				begin = pivot_pos + 1;
+				leftmost = false;
+			}
+		}
+
+		template <typename T, typename Compare>
+		void merge_sort(T* data, usize count, T* buffer, Compare& less) {
+			if (count <= insertion_sort_threshold) {
+				insertion_sort(data, data + count, less);
+				return;
+			}
+
+			const usize half = count / 2;
+			merge_sort(data, half, buffer, less);
+			merge_sort(data + half, count - half, buffer, less);
+
+			// Already in order across the middle
+			if (!less(data[half], data[half - 1])) return;
+
+			// Only the left half has to be moved out. The merge can never overwrite right elements it hasn't read yet.
+			if (ch::is_trivially_copyable<T>::value) {
+				ch::mem_copy(buffer, data, half * sizeof(T));
+			} else {
+				for (usize i = 0; i < half; i++) {
+					new (buffer + i) T(ch::move(data[i]));
+				}
+			}
+
+			usize l = 0;
+			usize r = half;
+			usize out = 0;
+			while (l < half && r < count) {
+				// Ties take from the left which is what keeps it stable
+				if (less(data[r], buffer[l])) {
+					data[out++] = ch::move(data[r++]);
+				} else {
+					data[out++] = ch::move(buffer[l++]);
+				}
+			}
+			while (l < half) {
+				data[out++] = ch::move(buffer[l++]);
+			}
+
+			if (!ch::is_trivially_copyable<T>::value) {
+				for (usize i = 0; i < half; i++) {
+					buffer[i].~T();
+				}
+			}
+		}
+
+		template <typename T, typename Compare>
+		void select(T* begin, T* end, T* nth, Compare& less) {
+			u32 bad_allowed = ch::find_last_set((u64)(end - begin)) + 1;
+			bool leftmost = true;
+
+			while ((usize)(end - begin) >= insertion_sort_threshold) {
+				choose_pivot(begin, end, less);
+
+				if (!leftmost && !less(begin[-1], *begin)) {
+					T* equal_end = partition_left(begin, end, less);
+					if (nth <= equal_end) return;
+					begin = equal_end + 1;
+					continue;
+				}
+
+				T* pivot_pos = partition(begin, end, less).pivot;
+				if (pivot_pos == nth) return;
+
+				const usize size = end - begin;
+				const usize l_size = pivot_pos - begin;
+				const usize r_size = end - (pivot_pos + 1);
+				if (l_size < size / 8 || r_size < size / 8) {
+					bad_allowed -= 1;
+					if (bad_allowed == 0) {
+						heap_sort(begin, end, less);
+						return;
+					}
+					break_patterns(begin, pivot_pos, end);
+				}
+
+				if (nth < pivot_pos) {
+					end = pivot_pos;
+				} else {
+					begin = pivot_pos + 1;
+					leftmost = false;
+				}
+			}
+
+			if (leftmost) {
+				insertion_sort(begin, end, less);
+			} else {
+				unguarded_insertion_sort(begin, end, less);
+			}
+		}
+
+		/** Maps numbers to unsigned integers that sort the same way */
+		CH_FORCEINLINE u8 to_radix_key(u8 x) { return x; }
+		CH_FORCEINLINE u16 to_radix_key(u16 x) { return x; }
+		CH_FORCEINLINE u32 to_radix_key(u32 x) { return x; }
+		CH_FORCEINLINE u64 to_radix_key(u64 x) { return x; }
+		CH_FORCEINLINE u8 to_radix_key(s8 x) { return (u8)x ^ 0x80; }
+		CH_FORCEINLINE u16 to_radix_key(s16 x) { return (u16)x ^ 0x8000; }
+		CH_FORCEINLINE u32 to_radix_key(s32 x) { return (u32)x ^ 0x80000000; }
+		CH_FORCEINLINE u64 to_radix_key(s64 x) { return (u64)x ^ 0x8000000000000000ull; }
+
+		/** Negative floats have every bit flipped so bigger magnitudes come first. Positive ones just get the sign bit set */
+		CH_FORCEINLINE u32 to_radix_key(f32 x) {
+			u32 bits;
+			ch::mem_copy(&bits, &x, sizeof(bits));
+			return bits ^ ((u32)((s32)bits >> 31) | 0x80000000);
+		}
+
+		CH_FORCEINLINE u64 to_radix_key(f64 x) {
+			u64 bits;
+			ch::mem_copy(&bits, &x, sizeof(bits));
+			return bits ^ ((u64)((s64)bits >> 63) | 0x8000000000000000ull);
+		}
+	}
+
+	/** Default key for radix_sort. Works on any integer or float */
+	template <typename T>
+	struct Radix_Key {
+		CH_FORCEINLINE auto operator()(const T& t) const { return sort_internal::to_radix_key(t); }
+	};
+
+	/** Not stable. less is anything callable as less(a, b) that's a strict weak ordering */
+	template <typename T, typename Compare>
+	void sort(T* data, usize count, Compare less) {
+		if (count < 2) return;
+		sort_internal::pdq_sort(data, data + count, less, ch::find_last_set((u64)count) + 1, true);
+	}
+
+	template <typename T>
+	void sort(T* data, usize count) {
+		ch::sort(data, count, ch::Less<T>());
+	}
+
+	/** Keeps equal elements in the order they came in. Takes scratch memory for count / 2 elements from scratch */
+	template <typename T, typename Compare>
+	void stable_sort(T* data, usize count, Compare less, const ch::Allocator& scratch = ch::context_allocator) {
+		if (count < 2) return;
+
+		ch::Allocator allocator = scratch;
+		const usize alignment = alignof(T) > ch::default_alignment ? alignof(T) : ch::default_alignment;
+		const usize buffer_size = (count / 2) * sizeof(T);
+		T* buffer = (T*)allocator.alloc_aligned(buffer_size, alignment);
+		assert(buffer);
+
+		sort_internal::merge_sort(data, count, buffer, less);
+		allocator.free_sized(buffer, buffer_size, alignment);
+	}
+
+	template <typename T>
+	void stable_sort(T* data, usize count, const ch::Allocator& scratch = ch::context_allocator) {
+		ch::stable_sort(data, count, ch::Less<T>(), scratch);
+	}
+
+	/**
+	 * Stable LSD radix sort on a byte of the key at a time
+	 *
+	 * key(t) has to give back an unsigned integer that orders elements the way they should end up. Bytes that are the
+	 * same for every key are skipped. T has to be trivially copyable since elements get copied into scratch memory.
+	 */
+	template <typename T, typename Key_Func>
+	void radix_sort(T* data, usize count, Key_Func key, const ch::Allocator& scratch = ch::context_allocator) {
+		static_assert(ch::is_trivially_copyable<T>::value, "radix_sort copies elements bitwise");
+		using Key = decltype(key(*data));
+		const usize num_passes = sizeof(Key);
+
+		// Clearing the histograms costs more than the sort on tiny arrays
+		if (count < 64) {
+			auto less = [&key](const T& a, const T& b) { return key(a) < key(b); };
+			sort_internal::insertion_sort(data, data + count, less);
+			return;
+		}
+
+		usize counts[num_passes][256];
+		ch::mem_zero(counts, sizeof(counts));
+		for (usize i = 0; i < count; i++) {
+			const Key k = key(data[i]);
+			for (usize pass = 0; pass < num_passes; pass++) {
+				counts[pass][(k >> (pass * 8)) & 0xff] += 1;
+			}
+		}
+
+		ch::Allocator allocator = scratch;
+		const usize alignment = alignof(T) > ch::default_alignment ? alignof(T) : ch::default_alignment;
+		T* buffer = (T*)allocator.alloc_aligned(count * sizeof(T), alignment);
+		assert(buffer);
+
+		T* src = data;
+		T* dest = buffer;
+		for (usize pass = 0; pass < num_passes; pass++) {
+			usize* pass_counts = counts[pass];
+			const usize shift = pass * 8;
+
+			// Every key has the same byte here so this pass wouldn't move anything
+			if (pass_counts[(key(src[0]) >> shift) & 0xff] == count) continue;
+
+			usize offset = 0;
+			for (usize i = 0; i < 256; i++) {
+				const usize digit_count = pass_counts[i];
+				pass_counts[i] = offset;
+				offset += digit_count;
+			}
+
+			for (usize i = 0; i < count; i++) {
+				const usize digit = (key(src[i]) >> shift) & 0xff;
+				dest[pass_counts[digit]++] = src[i];
+			}
+
+			T* temp = src;
+			src = dest;
+			dest = temp;
+		}
+
+		if (src != data) ch::mem_copy(data, src, count * sizeof(T));
+		allocator.free_sized(buffer, count * sizeof(T), alignment);
+	}
+
+	template <typename T>
+	void radix_sort(T* data, usize count, const ch::Allocator& scratch = ch::context_allocator) {
+		ch::radix_sort(data, count, ch::Radix_Key<T>(), scratch);
+	}
+
+	/** Puts the element that would be at nth if the whole range was sorted there. Nothing before it is bigger and nothing after it smaller */
+	template <typename T, typename Compare>
+	void nth_element(T* data, usize count, usize nth, Compare less) {
+		if (nth >= count) return;
+		sort_internal::select(data, data + count, data + nth, less);
+	}
+
+	template <typename T>
+	void nth_element(T* data, usize count, usize nth) {
+		ch::nth_element(data, count, nth, ch::Less<T>());
+	}
+
+	/** Sorts the smallest middle elements into the front. The rest are left in no particular order */
+	template <typename T, typename Compare>
+	void partial_sort(T* data, usize count, usize middle, Compare less) {
+		if (middle == 0) return;
+		if (middle >= count) {
+			ch::sort(data, count, less);
+			return;
+		}
+
+		ch::nth_element(data, count, middle - 1, less);
+		ch::sort(data, middle - 1, less);
+	}
+
+	template <typename T>
+	void partial_sort(T* data, usize count, usize middle) {
+		ch::partial_sort(data, count, middle, ch::Less<T>());
+	}
+
+	template <typename T> void sort(ch::Array<T>& array) { ch::sort(array.data, array.count); }
+	template <typename T, typename Compare> void sort(ch::Array<T>& array, Compare less) { ch::sort(array.data, array.count, less); }
+	template <typename T> void stable_sort(ch::Array<T>& array) { ch::stable_sort(array.data, array.count, array.allocator); }
+	template <typename T, typename Compare> void stable_sort(ch::Array<T>& array, Compare less) { ch::stable_sort(array.data, array.count, less, array.allocator); }
+	template <typename T> void radix_sort(ch::Array<T>& array) { ch::radix_sort(array.data, array.count, array.allocator); }
+	template <typename T, typename Key_Func> void radix_sort(ch::Array<T>& array, Key_Func key) { ch::radix_sort(array.data, array.count, key, array.allocator); }
+
+	template <typename T, usize N> void sort(ch::Small_Array<T, N>& array) { ch::sort(array.data, array.count); }
+	template <typename T, usize N, typename Compare> void sort(ch::Small_Array<T, N>& array, Compare less) { ch::sort(array.data, array.count, less); }
+	template <typename T, usize N> void stable_sort(ch::Small_Array<T, N>& array) { ch::stable_sort(array.data, array.count, array.allocator); }
+	template <typename T, usize N, typename Compare> void stable_sort(ch::Small_Array<T, N>& array, Compare less) { ch::stable_sort(array.data, array.count, less, array.allocator); }
+}
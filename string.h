@@ -154,11 +154,7 @@ namespace ch {
         bool operator==(const Base_String<T>& right) const {
             if (count != right.count) return false;
 
-            for (usize i = 0; i < count; i++) {
-                if (data[i] != right[i]) return false;
-            }
-
-            return true;
+            return ch::mem_equal(data, right.data, count * sizeof(T));
         }
 
         bool operator!=(const Base_String<T>& right) const {
@@ -169,11 +165,7 @@ namespace ch {
 			const usize c_count = ch::strlen(c_str);
 			if (count != c_count) return false;
 
-			for (usize i = 0; i < count; i++) {
-				if (data[i] != c_str[i]) return false;
-			}
-
-			return true;
+			return ch::mem_equal(data, c_str, count * sizeof(T));
 		}
 
 		bool operator!=(const char* c_str) const {
@@ -183,10 +175,11 @@ namespace ch {
         void reserve(usize amount) {
             assert(allocator);
 
+            const usize old_allocated = allocated;
             allocated += amount;
 
             if (data) {
-                data = (T*)ch_realloc(data, allocated * sizeof(T));
+                data = (T*)allocator.realloc_sized(data, old_allocated * sizeof(T), allocated * sizeof(T));
             } else {
                 data = ch_new(allocator) T[allocated];
             }
@@ -195,7 +188,7 @@ namespace ch {
         void free() {
             if (data) {
                 assert(allocated && allocator);
-                operator ch_delete[](data, allocator);
+                allocator.free_sized(data, allocated * sizeof(T));
                 data = nullptr;
             }
             count = 0;
@@ -336,6 +329,8 @@ namespace ch {
 		}
 
 		ssize find_from_left(char c) const {
+			if (sizeof(T) == 1) return ch::mem_find_byte(data, count, (u8)c);
+
 			for (usize i = 0; i < count; i++) {
 				if (data[i] == c) return i;
 			}
@@ -344,7 +339,10 @@ namespace ch {
 		}
 
 		ssize find_from_right(char c) const {
-			for (usize i = count - 1; i >= 0; i--) {
+			if (sizeof(T) == 1) return ch::mem_find_last_byte(data, count, (u8)c);
+
+			for (usize i = count; i > 0;) {
+				i--;
 				if (data[i] == c) {
 					return i;
 				}
@@ -389,11 +387,8 @@ namespace ch {
 		bool operator==(const char* c_str) const {
 			const usize len = ch::strlen(c_str);
 			if (len != allocated) return false;
-			for (usize i = 0; i < allocated; i += 1) {
-				if (data[i] != c_str[i]) return false;
-			}
-			
-			return true;
+
+			return ch::mem_equal(data, c_str, allocated);
 		}
 	};
 
@@ -404,7 +399,7 @@ namespace ch {
 		result.data = (char*)c_str;
 		result.count = ch::strlen(c_str);
 		result.allocated = result.count;
-		result.allocator = ch::get_stack_allocator();
+		result.allocator = ch::get_null_allocator();
 
 		return result;
 	}
@@ -567,15 +562,19 @@ namespace ch {
 
 	bool atof(const char* tstr, f32* f);
 	CH_FORCEINLINE bool atof(const ch::String& s, f32* f) {
-		char* tstr = s.to_tstring();
-		defer(ch::context_allocator.free(tstr));
+		ch::Temp_Arena scratch = ch::begin_scratch();
+		defer(ch::end_temp(scratch));
+
+		char* tstr = s.to_tstring(scratch.allocator);
 		return atof(tstr, f);
 	}
 
 	bool atoi(const char* tstr, s32* i);
 	CH_FORCEINLINE bool atoi(const ch::String& s, s32* i) {
-		char* tstr = s.to_tstring();
-		defer(ch::context_allocator.free(tstr));
+		ch::Temp_Arena scratch = ch::begin_scratch();
+		defer(ch::end_temp(scratch));
+
+		char* tstr = s.to_tstring(scratch.allocator);
 		return atoi(tstr, i);
 	}
 }
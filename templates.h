@@ -10,4 +10,50 @@ namespace ch {
     template <typename T> inline T&& forward(typename remove_reference<T>::Type& t) { return static_cast<T&&>(t); }
     template <typename T> inline T&& forward(typename remove_reference<T>::Type&& t) { return static_cast<T&&>(t); }
     template <typename T> constexpr T&& move(T& t) { return static_cast<typename remove_reference<T>::Type&&>(t); }
+
+    template <typename T>
+    inline void swap(T& a, T& b) {
+        T temp(ch::move(a));
+        a = ch::move(b);
+        b = ch::move(temp);
+    }
+
+    /**
+     * True when operator== on T gives the same answer as comparing the bytes
+     * 
+     * Containers use this to hand comparisons and searches off to the mem functions. Floats are left out on purpose
+     * because -0 == 0 and NaN != NaN.
+     */
+    template <typename T> struct is_bitwise_comparable     { static const bool value = false; };
+    template <typename T> struct is_bitwise_comparable<T*> { static const bool value = true; };
+
+#define CH_BITWISE_COMPARABLE(type) template <> struct is_bitwise_comparable<type> { static const bool value = true; }
+    CH_BITWISE_COMPARABLE(bool);
+    CH_BITWISE_COMPARABLE(char);
+    CH_BITWISE_COMPARABLE(signed char);
+    CH_BITWISE_COMPARABLE(unsigned char);
+    CH_BITWISE_COMPARABLE(short);
+    CH_BITWISE_COMPARABLE(unsigned short);
+    CH_BITWISE_COMPARABLE(int);
+    CH_BITWISE_COMPARABLE(unsigned int);
+    CH_BITWISE_COMPARABLE(long);
+    CH_BITWISE_COMPARABLE(unsigned long);
+    CH_BITWISE_COMPARABLE(long long);
+    CH_BITWISE_COMPARABLE(unsigned long long);
+#undef CH_BITWISE_COMPARABLE
+
+    /** Copying T is the same as copying its bytes and there's nothing to do when it goes away */
+    template <typename T> struct is_trivially_copyable { static const bool value = __is_trivially_copyable(T); };
+
+    /**
+     * T can be moved to a new address by copying its bytes and forgetting about the old one without running its move
+     * constructor or destructor
+     *
+     * Anything trivially copyable is. Most types that only own memory through pointers are too as long as nothing points
+     * back into the object itself. Use CH_TRIVIALLY_RELOCATABLE on those so containers can keep moving them with the mem
+     * functions.
+     */
+    template <typename T> struct is_trivially_relocatable { static const bool value = is_trivially_copyable<T>::value; };
+
+#define CH_TRIVIALLY_RELOCATABLE(type) template <> struct ch::is_trivially_relocatable<type> { static const bool value = true; }
 }
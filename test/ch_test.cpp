@@ -8,12 +8,20 @@
 
 #include <allocator.h>
 #include <array.h>
+#include <small_array.h>
+#include <sort.h>
+#include <parallel_sort.h>
 #include <templates.h>
 #include <filesystem.h>
 #include <opengl.h>
 #include "../string.h"
 #include "../memory.h"
 #include "../math.h"
+#include "../heap_profiler.h"
+#include "../free_list_allocator.h"
+#include "../pool_allocator.h"
+#include "../thread_cache_allocator.h"
+#include "../thread.h"
 
 int test_failed = 0;
 
@@ -39,6 +47,215 @@ static void memory_test() {
         TEST_FAIL("ch::memmove is broken");
     }
 
+    // Run every size from 0 to a few vectors wide at odd offsets through each kernel the cpu supports
+    {
+        const ch::Mem_Kernel_Type default_kernel = ch::get_mem_kernel_type();
+        defer(ch::set_mem_kernel_type(default_kernel));
+
+        const usize kernel_buffer_size = 512;
+        u8* a = ch_new u8[kernel_buffer_size];
+        u8* b = ch_new u8[kernel_buffer_size];
+        defer(ch_delete[] a);
+        defer(ch_delete[] b);
+
+        for (u32 kernel = ch::MKT_Scalar; kernel <= ch::MKT_AVX2; kernel += 1) {
+            if (!ch::set_mem_kernel_type((ch::Mem_Kernel_Type)kernel)) continue;
+
+            bool copy_ok = true;
+            bool move_ok = true;
+            bool set_ok = true;
+            for (usize size = 0; size < 200; size++) {
+                for (usize offset = 0; offset < 8; offset++) {
+                    for (usize i = 0; i < kernel_buffer_size; i++) {
+                        a[i] = (u8)(i * 7);
+                        b[i] = 0;
+                    }
+
+                    ch::mem_copy(b + offset, a + 3, size);
+                    for (usize i = 0; i < kernel_buffer_size; i++) {
+                        const u8 expected = (i >= offset && i < offset + size) ? (u8)((i - offset + 3) * 7) : 0;
+                        if (b[i] != expected) copy_ok = false;
+                    }
+
+                    ch::mem_move(a + offset + 5, a + 5, size);
+                    for (usize i = 0; i < kernel_buffer_size; i++) {
+                        const u8 expected = (i >= offset + 5 && i < offset + 5 + size) ? (u8)((i - offset) * 7) : (u8)(i * 7);
+                        if (a[i] != expected) move_ok = false;
+                    }
+
+                    ch::mem_set(b + offset, size, 0xcd);
+                    for (usize i = offset; i < offset + size; i++) {
+                        if (b[i] != 0xcd) set_ok = false;
+                    }
+                    if (b[offset + size] == 0xcd) set_ok = false;
+                }
+            }
+
+            const char* kernel_name = ch::get_mem_kernel_name((ch::Mem_Kernel_Type)kernel);
+            if (!copy_ok) {
+                TEST_FAIL("ch::mem_copy %s kernel is broken", kernel_name);
+            } else {
+                TEST_PASS("ch::mem_copy %s kernel", kernel_name);
+            }
+
+            if (!move_ok) {
+                TEST_FAIL("ch::mem_move %s kernel is broken", kernel_name);
+            } else {
+                TEST_PASS("ch::mem_move %s kernel", kernel_name);
+            }
+
+            if (!set_ok) {
+                TEST_FAIL("ch::mem_set %s kernel is broken", kernel_name);
+            } else {
+                TEST_PASS("ch::mem_set %s kernel", kernel_name);
+            }
+
+            bool streaming_ok = true;
+            for (usize size = 0; size < 400; size += 7) {
+                for (usize i = 0; i < kernel_buffer_size; i++) {
+                    a[i] = (u8)(i * 3);
+                    b[i] = 0;
+                }
+
+                ch::mem_copy_streaming(b + 1, a + 2, size);
+                for (usize i = 0; i < kernel_buffer_size; i++) {
+                    const u8 expected = (i >= 1 && i < 1 + size) ? (u8)((i + 1) * 3) : 0;
+                    if (b[i] != expected) streaming_ok = false;
+                }
+            }
+
+            if (!streaming_ok) {
+                TEST_FAIL("ch::mem_copy_streaming %s kernel is broken", kernel_name);
+            } else {
+                TEST_PASS("ch::mem_copy_streaming %s kernel", kernel_name);
+            }
+
+            bool compare_ok = true;
+            bool find_ok = true;
+            for (usize size = 1; size < 200; size++) {
+                for (usize i = 0; i < kernel_buffer_size; i++) {
+                    a[i] = (u8)i;
+                    b[i] = (u8)i;
+                }
+
+                if (ch::mem_compare(a + 1, b + 1, size) != 0) compare_ok = false;
+                b[size] += 1;
+                if (ch::mem_compare(a + 1, b + 1, size) >= 0) compare_ok = false;
+                if (ch::mem_compare(b + 1, a + 1, size) <= 0) compare_ok = false;
+
+                ch::mem_set(a, kernel_buffer_size, 0);
+                a[1 + size / 3] = 0xee;
+                a[size] = 0xee;
+                if (ch::mem_find_byte(a + 1, size, 0xee) != (ssize)(size / 3)) find_ok = false;
+                if (ch::mem_find_last_byte(a + 1, size, 0xee) != (ssize)(size - 1)) find_ok = false;
+                if (ch::mem_find_byte(a + 1, size, 0xff) != -1) find_ok = false;
+            }
+
+            if (!compare_ok) {
+                TEST_FAIL("ch::mem_compare %s kernel is broken", kernel_name);
+            } else {
+                TEST_PASS("ch::mem_compare %s kernel", kernel_name);
+            }
+
+            if (!find_ok) {
+                TEST_FAIL("ch::mem_find_byte %s kernel is broken", kernel_name);
+            } else {
+                TEST_PASS("ch::mem_find_byte %s kernel", kernel_name);
+            }
+        }
+    }
+
+
+#if CH_BUILD_DEBUG
+    {
+        const usize old_num_allocations = ch::get_num_allocations();
+        const u64 leak_line = __LINE__ + 1;
+        void* leak = ch_malloc(123);
+
+        ch::Allocation_Site sites[16];
+        const usize num_sites = ch::get_live_allocation_sites(sites, 16);
+        bool found_site = false;
+        for (usize i = 0; i < num_sites; i++) {
+            if (sites[i].line == leak_line && sites[i].bytes >= 123) found_site = true;
+        }
+
+        if (ch::get_num_allocations() != old_num_allocations + 1 || !found_site) {
+            TEST_FAIL("Debug allocation tracking is broken");
+        } else {
+            TEST_PASS("Debug allocation tracking");
+        }
+
+        ch_free(leak);
+        if (ch::get_num_allocations() != old_num_allocations) {
+            TEST_FAIL("Debug allocation tracking after free is broken");
+        } else {
+            TEST_PASS("Debug allocation tracking after free");
+        }
+    }
+#endif
+
+    {
+        // Interval of 1 byte samples everything so the numbers come out exact
+        const usize num_blocks = 16;
+        const usize block_size = 4096;
+        void* blocks[num_blocks];
+
+        ch::start_heap_profiler(1);
+        for (usize i = 0; i < num_blocks; i++) {
+            blocks[i] = ch_malloc(block_size);
+        }
+
+        auto get_live_bytes = []() {
+            ch::Heap_Profile_Snapshot snapshot = ch::take_heap_profile_snapshot();
+            defer(snapshot.free());
+
+            u64 result = 0;
+            for (usize i = 0; i < snapshot.num_sites; i++) {
+                result += snapshot.sites[i].live_bytes;
+            }
+            return result;
+        };
+
+        // The first allocation on a thread only starts its countdown
+        if (get_live_bytes() < (num_blocks - 1) * block_size) {
+            TEST_FAIL("Heap profiler is missing live allocations");
+        } else {
+            TEST_PASS("Heap profiler live bytes");
+        }
+
+        for (usize i = 0; i < num_blocks; i++) {
+            ch_free(blocks[i]);
+        }
+
+        if (get_live_bytes() != 0) {
+            TEST_FAIL("Heap profiler is not seeing frees");
+        } else {
+            TEST_PASS("Heap profiler frees");
+        }
+        ch::stop_heap_profiler();
+    }
+
+    {
+        const usize reserve_size = 16 * 1024 * 1024;
+        const usize commit_size = 64 * 1024;
+        u8* memory = (u8*)ch::reserve_memory(reserve_size, ch::VMF_Huge_Pages);
+
+        if (!memory || !ch::commit_memory(memory, commit_size)) {
+            TEST_FAIL("ch::reserve_memory/commit_memory failed");
+        } else {
+            ch::mem_set(memory, commit_size, 0xcd);
+            ch::decommit_memory(memory, commit_size);
+            ch::commit_memory(memory, commit_size);
+
+            // Recommitted pages come back zeroed
+            if (memory[0] != 0 || memory[commit_size - 1] != 0) {
+                TEST_FAIL("ch::decommit_memory did not give the pages back");
+            } else {
+                TEST_PASS("Virtual memory reserve/commit/decommit");
+            }
+        }
+        if (memory) ch::release_memory(memory, reserve_size);
+    }
 
     ch::Allocator arena = ch::make_arena_allocator(1024);
     defer(ch::destroy_arena_allocator(&arena));
@@ -46,14 +263,15 @@ static void memory_test() {
         u8* foo = (u8*)arena.alloc(256);
         u8* bar = (u8*)arena.alloc(256);
         ch::Arena_Allocator_Header* header = arena.get_header<ch::Arena_Allocator_Header>();
-        if (header->current != 512) {
+        if (header->current != (usize)(bar + 256 - (u8*)header->data)) {
             TEST_FAIL("Arean allocator book keeping is off");
         } else {
             TEST_PASS("Arena allocator book keeping");
         }
 
+        // Room for the size of each allocation in between
         const usize distance = bar - foo;
-        if (distance != 256) {
+        if (distance < 256 || distance > 256 + ch::default_alignment) {
             TEST_FAIL("Arean allocator allocation distance makes no sense");
         } else {
             TEST_PASS("Arena allocator allocation");
@@ -61,7 +279,7 @@ static void memory_test() {
 
         ch::reset_arena_allocator(&arena);
         bar = (u8*)arena.alloc(256);
-        if (header->current != 256) {
+        if (header->current != (usize)(bar + 256 - (u8*)header->data)) {
             TEST_FAIL("Arean allocator book keeping after reset is broken");
         }
         else {
@@ -73,9 +291,651 @@ static void memory_test() {
         } else {
             TEST_PASS("Arena allocation after reset");
         }
+
+        // bar is the last allocation so it grows and shrinks without moving
+        bar[0] = 0xab;
+        u8* grown = (u8*)arena.realloc(bar, 512);
+        u8* shrunk = (u8*)arena.realloc(grown, 64);
+        if (grown != bar || shrunk != bar || header->current != (usize)(bar + 64 - (u8*)header->data)) {
+            TEST_FAIL("Arena allocator in place realloc is broken");
+        } else {
+            TEST_PASS("Arena allocator in place realloc");
+        }
+
+        // Not the last allocation any more so it has to move and only its 64 bytes come with it
+        u8* baz = (u8*)arena.alloc(16);
+        u8* moved = (u8*)arena.realloc(bar, 128);
+        if (moved == bar || moved[0] != 0xab) {
+            TEST_FAIL("Arena allocator realloc that moves is broken");
+        } else {
+            TEST_PASS("Arena allocator realloc that moves");
+        }
+
+        const usize before_free = header->current;
+        arena.free(moved);
+        arena.free(baz);
+        if (header->current >= before_free - 128) {
+            TEST_FAIL("Arena allocator is not giving back the last allocation on free");
+        } else {
+            TEST_PASS("Arena allocator free of the last allocation");
+        }
+    }
+
+    {
+        ch::Allocator virtual_arena = ch::make_virtual_arena_allocator(256 * 1024 * 1024);
+        defer(ch::free_arena_allocator(&virtual_arena));
+        ch::Arena_Allocator_Header* header = virtual_arena.get_header<ch::Arena_Allocator_Header>();
+
+        // Way past anything committed up front
+        u8* first = (u8*)virtual_arena.alloc(1024);
+        u8* big = (u8*)virtual_arena.alloc(8 * 1024 * 1024);
+        big[8 * 1024 * 1024 - 1] = 0xff;
+        if (big < first + 1024 || header->allocated < header->current || header->allocated >= header->reserved) {
+            TEST_FAIL("Virtual arena allocator is not committing on demand");
+        } else {
+            TEST_PASS("Virtual arena allocator growth");
+        }
+
+        // The next cycle only peaks at 1kb so everything committed past that goes back
+        ch::reset_arena_allocator(&virtual_arena, true);
+        virtual_arena.alloc(1024);
+        ch::reset_arena_allocator(&virtual_arena, true);
+        if (header->current != 0 || header->allocated >= 8 * 1024 * 1024) {
+            TEST_FAIL("Virtual arena allocator reset is not decommitting");
+        } else {
+            TEST_PASS("Virtual arena allocator decommit on reset");
+        }
+
+        u8* after = (u8*)virtual_arena.alloc(2 * 1024 * 1024);
+        after[2 * 1024 * 1024 - 1] = 1;
+        if (after != first) {
+            TEST_FAIL("Virtual arena allocation after decommit is not correct");
+        } else {
+            TEST_PASS("Virtual arena allocation after decommit");
+        }
+    }
+
+    {
+        ch::Allocator temp_arena = ch::make_arena_allocator(4096);
+        defer(ch::free_arena_allocator(&temp_arena));
+        ch::Arena_Allocator_Header* header = temp_arena.get_header<ch::Arena_Allocator_Header>();
+
+        u8* keep = (u8*)temp_arena.alloc(64);
+        const usize before = header->current;
+        {
+            ch::Temp_Arena_Scope scope(temp_arena);
+            temp_arena.alloc(1024);
+
+            ch::Temp_Arena inner = ch::begin_temp(temp_arena);
+            temp_arena.alloc(1024);
+            ch::end_temp(inner);
+        }
+
+        // keep is the last allocation again so it should still grow in place
+        if (header->current != before || temp_arena.realloc(keep, 128) != keep) {
+            TEST_FAIL("Temp_Arena did not roll the arena back");
+        } else {
+            TEST_PASS("Temp_Arena");
+        }
+
+        // An allocation from before the temp can't grow inside it and then get cut short by end_temp
+        u8* before_temp = (u8*)temp_arena.alloc(16);
+        ch::Temp_Arena temp = ch::begin_temp(temp_arena);
+        u8* moved = (u8*)temp_arena.realloc(before_temp, 256);
+        ch::end_temp(temp);
+        u8* after_temp = (u8*)temp_arena.alloc(64);
+        if (moved == before_temp || (after_temp >= before_temp && after_temp < before_temp + 16)) {
+            TEST_FAIL("Temp_Arena let an older allocation grow into it");
+        } else {
+            TEST_PASS("Temp_Arena older allocation");
+        }
+
+        ch::Temp_Arena outer = ch::begin_scratch();
+        ch::Temp_Arena inner = ch::begin_scratch(&outer.allocator);
+        if (outer.allocator.data == inner.allocator.data) {
+            TEST_FAIL("ch::begin_scratch handed back the conflicting arena");
+        } else {
+            TEST_PASS("ch::begin_scratch conflicts");
+        }
+        ch::end_temp(inner);
+        ch::end_temp(outer);
+    }
+
+    {
+        static ch::Allocator concurrent = ch::make_concurrent_arena_allocator(64 * 1024 * 1024, 4096);
+        const usize num_threads = 4;
+        const usize blocks_per_thread = 2048;
+        static u8* blocks[num_threads][blocks_per_thread];
+
+        // Sizes cross the big allocation cut off so both paths get claimed from at the same time
+        ch::Thread threads[num_threads];
+        for (usize i = 0; i < num_threads; i++) {
+            ch::create_thread([](void* param) {
+                const usize index = (usize)param;
+                for (usize j = 0; j < blocks_per_thread; j++) {
+                    const usize size = 1 + (j * 37) % 1500;
+                    blocks[index][j] = (u8*)concurrent.alloc(size);
+                    ch::mem_set(blocks[index][j], size, (u8)(index * 31 + j));
+                }
+            }, (void*)i, &threads[i]);
+        }
+
+        bool kept_contents = true;
+        for (usize i = 0; i < num_threads; i++) {
+            ch::join_thread(&threads[i]);
+        }
+        for (usize i = 0; i < num_threads; i++) {
+            for (usize j = 0; j < blocks_per_thread; j++) {
+                const usize size = 1 + (j * 37) % 1500;
+                if (!ch::is_aligned(blocks[i][j], ch::default_alignment)) kept_contents = false;
+                for (usize k = 0; k < size; k++) {
+                    if (blocks[i][j][k] != (u8)(i * 31 + j)) kept_contents = false;
+                }
+            }
+        }
+
+        const ch::Allocator_Stats threaded = concurrent.get_stats();
+        if (threaded.total_allocations != num_threads * blocks_per_thread || threaded.num_failed_allocations) kept_contents = false;
+
+        if (!kept_contents) {
+            TEST_FAIL("Concurrent arena allocator is handing out the same memory twice");
+        } else {
+            TEST_PASS("Concurrent arena allocator across threads");
+        }
+
+        u8* last = (u8*)concurrent.alloc(64);
+        u8* grown = (u8*)concurrent.realloc(last, 128);
+        ch::reset_concurrent_arena_allocator(&concurrent);
+        ch::Concurrent_Arena_Header* header = concurrent.get_header<ch::Concurrent_Arena_Header>();
+        u8* after_reset = (u8*)concurrent.alloc(64);
+        const bool too_big_failed = concurrent.alloc(128 * 1024 * 1024) == nullptr;
+        const ch::Allocator_Stats reset_stats = concurrent.get_stats();
+        if (grown != last || after_reset != (u8*)header->data + ch::default_alignment || !too_big_failed ||
+            reset_stats.total_allocations != 1 || reset_stats.num_failed_allocations != 1) {
+            TEST_FAIL("Concurrent arena allocator reset is broken");
+        } else {
+            TEST_PASS("Concurrent arena allocator reset");
+        }
+        ch::free_concurrent_arena_allocator(&concurrent);
+    }
+
+    {
+        ch::Allocator arena = ch::make_arena_allocator(4096);
+        defer(ch::free_arena_allocator(&arena));
+        ch::Arena_Allocator_Header* header = arena.get_header<ch::Arena_Allocator_Header>();
+        u8* const arena_start = (u8*)header->data;
+
+        static ch::Allocator other_thread_allocator;
+        bool scoped = false;
+        bool nested = false;
+        {
+            ch::Context_Allocator_Scope scope(arena);
+            ch::Array<u32> numbers;
+            numbers.push(1);
+            scoped = (u8*)numbers.data >= arena_start && (u8*)numbers.data < arena_start + header->allocated;
+
+            {
+                ch::Context_Allocator_Scope inner(ch::get_null_allocator());
+                nested = ch::context_allocator.func != arena.func;
+            }
+            nested = nested && ch::context_allocator.data == arena.data;
+
+            // Other threads keep their own
+            ch::Thread thread;
+            ch::create_thread([](void*) { other_thread_allocator = ch::context_allocator; }, nullptr, &thread);
+            ch::join_thread(&thread);
+        }
+
+        const ch::Allocator heap = ch::get_heap_allocator();
+        const bool restored = ch::context_allocator.func == heap.func;
+        if (!scoped || !nested || !restored || other_thread_allocator.func != heap.func) {
+            TEST_FAIL("ch::Context_Allocator_Scope is broken");
+        } else {
+            TEST_PASS("ch::Context_Allocator_Scope");
+        }
+    }
+
+    {
+        ch::Allocator free_list = ch::make_free_list_allocator(256 * 1024);
+        defer(ch::free_free_list_allocator(&free_list));
+
+        const usize num_blocks = 256;
+        u8* blocks[num_blocks];
+        usize sizes[num_blocks];
+        for (usize i = 0; i < num_blocks; i++) {
+            // Mix of small classes and large blocks
+            sizes[i] = (i % 4 == 0) ? 4096 + i * 97 : 1 + i * 3;
+            blocks[i] = (u8*)free_list.alloc(sizes[i]);
+            ch::mem_set(blocks[i], sizes[i], (u8)i);
+        }
+
+        // Free every other one so the rest have free neighbours to grow into or merge with
+        for (usize i = 0; i < num_blocks; i += 2) {
+            free_list.free(blocks[i]);
+        }
+        for (usize i = 1; i < num_blocks; i += 2) {
+            blocks[i] = (u8*)free_list.realloc(blocks[i], sizes[i] * 2);
+        }
+
+        bool kept_contents = true;
+        for (usize i = 1; i < num_blocks; i += 2) {
+            if (!ch::is_aligned(blocks[i], ch::default_alignment)) kept_contents = false;
+            for (usize j = 0; j < sizes[i]; j++) {
+                if (blocks[i][j] != (u8)i) kept_contents = false;
+            }
+            free_list.free(blocks[i]);
+        }
+
+        // Everything merged back so this has to come out of the same chunk
+        ch::Free_List_Allocator_Header* header = free_list.get_header<ch::Free_List_Allocator_Header>();
+        const usize num_chunks = header->num_chunks;
+        free_list.alloc(128 * 1024);
+        const bool reused_chunk = header->num_chunks == num_chunks;
+
+        // Bigger than a chunk so it gets a chunk of its own
+        u8* big = (u8*)free_list.alloc(1100 * 1024);
+        u8* big_aligned = (u8*)free_list.alloc_aligned(300 * 1024, 4096);
+        const bool got_big = big && big_aligned && ch::is_aligned(big_aligned, 4096);
+        if (got_big) {
+            ch::mem_set(big, 1100 * 1024, 0xab);
+            ch::mem_set(big_aligned, 300 * 1024, 0xcd);
+            free_list.free(big);
+            free_list.free(big_aligned);
+        }
+
+        if (!kept_contents || !reused_chunk || !got_big) {
+            TEST_FAIL("Free list allocator is broken");
+        } else {
+            TEST_PASS("Free list allocator");
+        }
+    }
+
+    {
+        ch::Allocator counting = ch::make_counting_allocator(ch::get_heap_allocator());
+        defer(ch::free_counting_allocator(&counting));
+
+        void* a = counting.alloc(100);
+        void* b = counting.alloc(300);
+        b = counting.realloc(b, 1000);
+        counting.free(a);
+        const ch::Allocator_Stats mid = counting.get_stats();
+        counting.free(b);
+        const ch::Allocator_Stats counted = counting.get_stats();
+
+        const bool counts_right = mid.bytes_in_use == 1000 && mid.num_allocations == 1 && counted.bytes_in_use == 0 &&
+            counted.num_allocations == 0 && counted.total_allocations == 2 && counted.peak_bytes_in_use == 1100;
+
+        ch::Allocator arena = ch::make_arena_allocator(256);
+        defer(ch::free_arena_allocator(&arena));
+        arena.alloc(64);
+        arena.alloc(64);
+        const ch::Allocator_Stats arena_stats = arena.get_stats();
+        const bool arena_right = arena_stats.num_allocations == 2 && arena_stats.bytes_in_use >= 128 && arena_stats.bytes_reserved == 256;
+
+        // Running out of a virtual arena's reservation fails instead of committing past it
+        ch::Allocator virtual_arena = ch::make_virtual_arena_allocator(64 * 1024);
+        defer(ch::free_arena_allocator(&virtual_arena));
+        virtual_arena.alloc(1024);
+        const bool virtual_failed = virtual_arena.alloc(128 * 1024) == nullptr;
+        const ch::Allocator_Stats virtual_stats = virtual_arena.get_stats();
+        const bool virtual_right = virtual_failed && virtual_stats.num_allocations == 1 && virtual_stats.num_failed_allocations == 1;
+
+        // Freeing every other bucket leaves the free space in single bucket holes
+        ch::Allocator pool = ch::make_pool_allocator(32, 64);
+        defer(ch::free_pool_allocator(&pool));
+        void* buckets[64];
+        for (usize i = 0; i < 64; i++) buckets[i] = pool.alloc(32);
+        const bool pool_failed = pool.alloc(32) == nullptr;
+        for (usize i = 0; i < 64; i += 2) pool.free(buckets[i]);
+        const ch::Allocator_Stats holes = pool.get_stats();
+        for (usize i = 1; i < 64; i += 2) pool.free(buckets[i]);
+        const ch::Allocator_Stats empty = pool.get_stats();
+
+        const bool pool_right = pool_failed && holes.num_failed_allocations == 1 && holes.bytes_in_use == 32 * 32 &&
+            holes.peak_bytes_in_use == 64 * 32 && holes.fragmentation > 0.9f && empty.bytes_in_use == 0 && empty.fragmentation == 0.f;
+
+        if (!counts_right || !arena_right || !virtual_right || !pool_right) {
+            TEST_FAIL("Allocator stats are broken");
+        } else {
+            TEST_PASS("Allocator stats");
+        }
+    }
+
+    {
+        // Growing and freeing an array hands its size back every time
+        ch::Array<u32> numbers(ch::get_thread_cache_allocator());
+        for (u32 i = 0; i < 5000; i++) numbers.push(i);
+        bool kept_contents = true;
+        for (u32 i = 0; i < 5000; i++) {
+            if (numbers[i] != i) kept_contents = false;
+        }
+        numbers.free();
+
+        // Shrinking into a smaller size class has to move or a sized free would put it on the wrong list
+        ch::Allocator thread_cache = ch::get_thread_cache_allocator();
+        u8* shrunk = (u8*)thread_cache.alloc(1000);
+        ch::mem_set(shrunk, 1000, 0x3c);
+        shrunk = (u8*)thread_cache.realloc(shrunk, 100);
+        const bool shrunk_kept = shrunk[0] == 0x3c && shrunk[99] == 0x3c && ch::thread_cache_get_size(shrunk) < 1000;
+        thread_cache.free_sized(shrunk, 100);
+
+        // Below the top of the stack a sized realloc has to move and copy only what was there
+        ch::Allocator stack = ch::make_stack_allocator(8192);
+        defer(ch::free_stack_allocator(&stack));
+        u8* a = (u8*)stack.alloc(16);
+        ch::mem_set(a, 16, 0x7e);
+        stack.alloc(4096);
+        a = (u8*)stack.realloc_sized(a, 16, 32);
+        const ch::Stack_Allocator_Header* header = stack.get_header<ch::Stack_Allocator_Header>();
+        const bool stack_right = a && a[0] == 0x7e && a[15] == 0x7e && header->current < 4096 + 16 + 32 + 64;
+
+        if (!kept_contents || !shrunk_kept || !stack_right) {
+            TEST_FAIL("Sized frees are broken");
+        } else {
+            TEST_PASS("Sized frees");
+        }
+    }
+
+    {
+        // Each thread fills its blocks and the main thread checks and frees all of them so every free crosses threads
+        const usize num_threads = 4;
+        const usize blocks_per_thread = 1024;
+        static u8* blocks[num_threads][blocks_per_thread];
+
+        ch::Thread threads[num_threads];
+        for (usize i = 0; i < num_threads; i++) {
+            ch::create_thread([](void* param) {
+                const usize index = (usize)param;
+                for (usize j = 0; j < blocks_per_thread; j++) {
+                    const usize size = (j % 16 == 0) ? 40 * 1024 + j : 1 + j % 300;
+                    blocks[index][j] = (u8*)ch::thread_cache_malloc(size);
+                    ch::mem_set(blocks[index][j], size, (u8)(index + j));
+                }
+            }, (void*)i, &threads[i]);
+        }
+
+        bool kept_contents = true;
+        for (usize i = 0; i < num_threads; i++) {
+            ch::join_thread(&threads[i]);
+            for (usize j = 0; j < blocks_per_thread; j++) {
+                const usize size = (j % 16 == 0) ? 40 * 1024 + j : 1 + j % 300;
+                if (ch::thread_cache_get_size(blocks[i][j]) < size || !ch::is_aligned(blocks[i][j], ch::default_alignment)) kept_contents = false;
+                for (usize k = 0; k < size; k++) {
+                    if (blocks[i][j][k] != (u8)(i + j)) kept_contents = false;
+                }
+                ch::thread_cache_free(blocks[i][j]);
+            }
+        }
+
+        if (!kept_contents) {
+            TEST_FAIL("Thread cache allocator is broken across threads");
+        } else {
+            TEST_PASS("Thread cache allocator across threads");
+        }
+
+        // Memory from either backend has to keep going back to where it came from after a switch
+        const ch::Malloc_Backend old_backend = ch::get_malloc_backend();
+        ch::set_malloc_backend(ch::MB_OS);
+        void* os_block = ch::malloc(64);
+        ch::set_malloc_backend(ch::MB_Thread_Cache);
+        void* cache_block = ch::malloc(64);
+        const bool routed = !ch::thread_cache_owns(os_block) && ch::thread_cache_owns(cache_block);
+        cache_block = ch::realloc(cache_block, 100 * 1024);
+        ch::free(os_block);
+        ch::free(cache_block);
+        ch::set_malloc_backend(old_backend);
+
+        if (!routed || !cache_block) {
+            TEST_FAIL("ch::set_malloc_backend is not routing frees");
+        } else {
+            TEST_PASS("ch::set_malloc_backend");
+        }
+
+        // Size classes are only 16 byte aligned so anything more has to be done on top of them
+        ch::Allocator thread_cache = ch::get_thread_cache_allocator();
+        const usize num_aligned = 64;
+        u8* aligned[num_aligned];
+        bool all_aligned = true;
+        for (usize i = 0; i < num_aligned; i++) {
+            const usize alignment = (usize)64 << (i % 8);
+            aligned[i] = (u8*)thread_cache.alloc_aligned(48, alignment);
+            if (!ch::is_aligned(aligned[i], alignment)) all_aligned = false;
+            ch::mem_set(aligned[i], 48, (u8)i);
+            aligned[i] = (u8*)thread_cache.realloc_sized(aligned[i], 48, 40 * 1024 + i, alignment);
+            if (!ch::is_aligned(aligned[i], alignment) || aligned[i][0] != (u8)i || aligned[i][47] != (u8)i) all_aligned = false;
+        }
+        for (usize i = 0; i < num_aligned; i++) {
+            thread_cache.free_sized(aligned[i], 40 * 1024 + i, (usize)64 << (i % 8));
+        }
+
+        if (!all_aligned) {
+            TEST_FAIL("Thread cache allocator ignores alignment");
+        } else {
+            TEST_PASS("Thread cache allocator alignment");
+        }
+    }
+
+    {
+        ch::Allocator stack = ch::make_stack_allocator(4096);
+        defer(ch::free_stack_allocator(&stack));
+        ch::Stack_Allocator_Header* header = stack.get_header<ch::Stack_Allocator_Header>();
+
+        u8* a = (u8*)stack.alloc(64);
+        ch::push_stack_marker(stack, "frame");
+        u8* b = (u8*)stack.alloc(64);
+        u8* grown = (u8*)stack.realloc(b, 256);
+        const usize after_grow = header->current;
+        stack.alloc(32);
+        stack.alloc(32);
+
+        if (grown != b || after_grow != (usize)(b + 256 - (u8*)header->data)) {
+            TEST_FAIL("Stack allocator realloc of the top is not in place");
+        } else {
+            TEST_PASS("Stack allocator realloc of the top");
+        }
+
+        const bool popped = ch::pop_stack_marker(stack, "frame");
+        if (!popped || header->current != (usize)(a + 64 - (u8*)header->data) || ch::pop_stack_marker(stack, "frame")) {
+            TEST_FAIL("Stack allocator markers are broken");
+        } else {
+            TEST_PASS("Stack allocator markers");
+        }
+
+        stack.free(a);
+        if (header->current != 0) {
+            TEST_FAIL("Stack allocator free did not pop");
+        } else {
+            TEST_PASS("Stack allocator free");
+        }
+
+        // Freeing under a marker takes the marker with it so popping it can't bring the freed memory back
+        u8* under = (u8*)stack.alloc(64);
+        ch::push_stack_marker(stack, "freed");
+        stack.alloc(64);
+        stack.free(under);
+        const bool dropped = !ch::pop_stack_marker(stack, "freed") && header->current == 0;
+
+        // The top can't grow in place over a marker pushed after it
+        u8* top = (u8*)stack.alloc(64);
+        ch::push_stack_marker(stack, "above");
+        u8* moved = (u8*)stack.realloc(top, 128);
+        const bool kept_top = moved != top && ch::pop_stack_marker(stack, "above") && header->current == (usize)(top + 64 - (u8*)header->data);
+
+        if (!dropped || !kept_top) {
+            TEST_FAIL("Stack allocator markers over freed memory are broken");
+        } else {
+            TEST_PASS("Stack allocator markers over freed memory");
+        }
+    }
+
+    {
+        ch::Allocator heap = ch::get_heap_allocator();
+        u8* aligned = (u8*)heap.alloc_aligned(100, 64);
+        for (u8 i = 0; i < 100; i++) aligned[i] = i;
+
+        // Enough reallocs that the base pointer is bound to land on a different offset at some point
+        bool kept_contents = true;
+        for (usize size = 200; size < 64 * 1024; size *= 2) {
+            aligned = (u8*)heap.realloc_aligned(aligned, size, 64);
+            if (!ch::is_aligned(aligned, 64)) kept_contents = false;
+            for (u8 i = 0; i < 100; i++) {
+                if (aligned[i] != i) kept_contents = false;
+            }
+        }
+        heap.free_aligned(aligned, 64);
+
+        if (!kept_contents) {
+            TEST_FAIL("Heap allocator over aligned realloc is broken");
+        } else {
+            TEST_PASS("Heap allocator over aligned realloc");
+        }
+
+        ch::Allocator aligned_arena = ch::make_arena_allocator(4096);
+        defer(ch::free_arena_allocator(&aligned_arena));
+        aligned_arena.alloc(3);
+        void* a = aligned_arena.alloc_aligned(16, 32);
+        aligned_arena.alloc(1);
+        void* b = aligned_arena.alloc(16);
+        if (!ch::is_aligned(a, 32) || !ch::is_aligned(b, ch::default_alignment)) {
+            TEST_FAIL("Arena allocator is not honoring alignment");
+        } else {
+            TEST_PASS("Arena allocator alignment");
+        }
+
+        ch::Allocator pool = ch::make_pool_allocator(16, 64);
+        defer(ch::free_pool_allocator(&pool));
+        pool.alloc(16);
+        void* c = pool.alloc_aligned(16, 64);
+        if (!ch::is_aligned(c, 64)) {
+            TEST_FAIL("Pool allocator is not honoring alignment");
+        } else {
+            TEST_PASS("Pool allocator alignment");
+        }
+    }
+
+    {
+        // Enough buckets that runs have to cross words in the occupancy bitmap
+        ch::Allocator pool = ch::make_pool_allocator(16, 200);
+        defer(ch::free_pool_allocator(&pool));
+        ch::Pool_Allocator_Header* header = pool.get_header<ch::Pool_Allocator_Header>();
+
+        u8* a = (u8*)pool.alloc(16 * 60);
+        u8* b = (u8*)pool.alloc(16 * 10);
+        u8* c = (u8*)pool.alloc(16 * 10);
+        pool.free(b);
+
+        // Too big for the hole b left so it has to go after c and straddle two words
+        u8* d = (u8*)pool.alloc(16 * 20);
+        u8* grown = (u8*)pool.realloc(a, 16 * 65);
+        const usize used = header->get_num_used_buckets();
+
+        if (b != a + 16 * 60 || d != c + 16 * 10 || grown != a || used != 65 + 10 + 20) {
+            TEST_FAIL("Pool allocator runs are broken");
+        } else {
+            TEST_PASS("Pool allocator runs");
+        }
+
+        void* too_big = pool.alloc(16 * 200);
+        pool.free(grown);
+        pool.free(c);
+        pool.free(d);
+        if (too_big || header->get_num_used_buckets() != 0 || pool.alloc(16 * 200) != header->chunks->memory) {
+            TEST_FAIL("Pool allocator free is broken");
+        } else {
+            TEST_PASS("Pool allocator free");
+        }
+    }
+
+    {
+        ch::Allocator pool = ch::make_pool_allocator(32, 64, true);
+        defer(ch::free_pool_allocator(&pool));
+        ch::Pool_Allocator_Header* header = pool.get_header<ch::Pool_Allocator_Header>();
+
+        // Bigger than the first chunk and then enough to spill past it
+        u8* big = (u8*)pool.alloc(32 * 100);
+        u8* blocks[80];
+        for (usize i = 0; i < 80; i++) {
+            blocks[i] = (u8*)pool.alloc(32);
+            ch::mem_set(blocks[i], 32, (u8)i);
+        }
+
+        bool kept_contents = big != nullptr;
+        const bool grew = header->num_chunks >= 3 && header->get_num_buckets() >= 64 + 100 + 16;
+        for (usize i = 0; i < 80; i++) {
+            if (!blocks[i] || blocks[i][31] != (u8)i) kept_contents = false;
+            pool.free(blocks[i]);
+        }
+        pool.free(big);
+
+        // Chunks added by growing go away once they're empty
+        const bool shrank = header->num_chunks == 1 && header->get_num_buckets() == 64;
+
+        if (!kept_contents || !grew || !shrank || header->get_num_used_buckets() != 0) {
+            TEST_FAIL("Pool allocator growth is broken");
+        } else {
+            TEST_PASS("Pool allocator growth");
+        }
+    }
+
+    {
+        ch::Allocator objects = ch::make_object_pool_allocator(24, 16);
+        defer(ch::free_object_pool_allocator(&objects));
+
+        // Enough to need a few slabs
+        const usize num_objects = 40;
+        u8* allocated[num_objects];
+        for (usize i = 0; i < num_objects; i++) {
+            allocated[i] = (u8*)objects.alloc(24);
+            ch::mem_set(allocated[i], 24, (u8)i);
+        }
+
+        bool kept_contents = true;
+        for (usize i = 0; i < num_objects; i++) {
+            if (!ch::is_aligned(allocated[i], ch::default_alignment)) kept_contents = false;
+            for (usize j = 0; j < 24; j++) {
+                if (allocated[i][j] != (u8)i) kept_contents = false;
+            }
+        }
+
+        objects.free(allocated[7]);
+        objects.free(allocated[3]);
+        void* reused = objects.alloc(16);
+        const ch::Object_Pool_Stats stats = ch::get_object_pool_stats(objects);
+        if (!kept_contents || reused != allocated[3] || stats.num_slabs != 3 || stats.num_used != num_objects - 1 || stats.high_water != num_objects) {
+            TEST_FAIL("Object pool allocator is broken");
+        } else {
+            TEST_PASS("Object pool allocator");
+        }
+
+        ch::reset_object_pool_allocator(&objects);
+        for (usize i = 0; i < 48; i++) {
+            objects.alloc(24);
+        }
+        if (ch::get_object_pool_stats(objects).num_slabs != 3) {
+            TEST_FAIL("Object pool allocator reset is not reusing slabs");
+        } else {
+            TEST_PASS("Object pool allocator reset");
+        }
     }
 }
 
+/** Points at itself so any bitwise move shows up. Counts copies so moves can be told apart */
+struct Self_Ref {
+    Self_Ref* self;
+    s32 value;
+
+    static usize num_copies;
+
+    Self_Ref(s32 in_value = 0) : self(this), value(in_value) {}
+    Self_Ref(const Self_Ref& other) : self(this), value(other.value) { num_copies += 1; }
+    Self_Ref(Self_Ref&& other) : self(this), value(other.value) { other.value = -1; }
+    ~Self_Ref() { self = nullptr; }
+
+    Self_Ref& operator=(const Self_Ref& other) { value = other.value; num_copies += 1; return *this; }
+};
+
+usize Self_Ref::num_copies = 0;
+
 static void array_test() {
     {
         ch::Array<float> array;
@@ -103,6 +963,301 @@ static void array_test() {
             TEST_PASS("Array<float> initializer list");
         }
     }
+
+    {
+        ch::Array<float> array;
+        array.alignment = 64;
+        defer(array.free());
+
+        bool stayed_aligned = true;
+        for (usize i = 0; i < 1000; i++) {
+            array.push((float)i);
+            if (!ch::is_aligned(array.data, 64)) stayed_aligned = false;
+        }
+
+        if (!stayed_aligned || array[999] != 999.f) {
+            TEST_FAIL("Array<float> with 64 byte alignment lost its alignment");
+        } else {
+            TEST_PASS("Array<float> alignment");
+        }
+    }
+
+    {
+        static_assert(ch::is_trivially_relocatable<ch::Array<u32>>::value, "Arrays should be moved with the mem functions");
+        static_assert(!ch::is_trivially_relocatable<Self_Ref>::value, "Self_Ref can't be moved bitwise");
+
+        ch::Array<Self_Ref> array;
+        defer(array.free());
+
+        Self_Ref::num_copies = 0;
+        for (s32 i = 0; i < 100; i++) {
+            if (i % 2) {
+                array.push(Self_Ref(i));
+            } else {
+                array.emplace(i);
+            }
+        }
+        const bool no_copies = Self_Ref::num_copies == 0;
+
+        array.insert(Self_Ref(-5), 10);
+        array.remove(50);
+        array.push(array[0]);
+
+        ch::Array<Self_Ref> copied = array.copy();
+        defer(copied.free());
+
+        bool in_place = true;
+        for (usize i = 0; i < array.count; i++) {
+            if (array[i].self != &array[i] || copied[i].self != &copied[i] || copied[i].value != array[i].value) in_place = false;
+        }
+
+        const bool right_order = array[9].value == 9 && array[10].value == -5 && array[11].value == 10 && array[50].value == 50 &&
+            array.back().value == 0 && array.count == 101;
+
+        if (!no_copies || !in_place || !right_order) {
+            TEST_FAIL("Array<T> with non trivial T is broken");
+        } else {
+            TEST_PASS("Array<T> with non trivial T");
+        }
+    }
+
+    {
+        ch::Allocator counting = ch::make_counting_allocator(ch::get_heap_allocator());
+        defer(ch::free_counting_allocator(&counting));
+
+        ch::Small_Array<u32, 4> array(counting);
+        for (u32 i = 0; i < 4; i++) array.push(i);
+        const bool stayed_inline = array.is_inline() && counting.get_stats().total_allocations == 0;
+
+        // Copies of an inline array get their own elements
+        ch::Small_Array<u32, 4> inline_copy = array;
+        inline_copy[0] = 100;
+        const bool copied_inline = inline_copy.is_inline() && inline_copy.data != array.data && array[0] == 0;
+
+        for (u32 i = 4; i < 100; i++) array.push(i);
+        array.insert(1000, 2);
+        array.remove(0);
+        const bool spilled = !array.is_inline() && array.count == 100 && array[1] == 1000 && array[2] == 2 && array.back() == 99;
+
+        ch::Small_Array<u32, 4> heap_copy = array.copy(counting);
+        const bool copied_heap = heap_copy == array && heap_copy.data != array.data;
+        heap_copy.free();
+        array.free();
+
+        const bool freed = array.is_inline() && counting.get_stats().num_allocations == 0;
+        if (!stayed_inline || !copied_inline || !spilled || !copied_heap || !freed) {
+            TEST_FAIL("Small_Array is broken");
+        } else {
+            TEST_PASS("Small_Array");
+        }
+    }
+
+    {
+        u32 items[64];
+        for (u32 i = 0; i < 64; i++) items[i] = i;
+
+        ch::Array<u32> array;
+        defer(array.free());
+        array.push_range(items, 64);
+        array.insert_range(items, 3, 10);
+        array.remove_range(0, 10);
+        const bool ranges_right = array.count == 57 && array[0] == 0 && array[2] == 2 && array[3] == 10 && array.back() == 63;
+
+        // Odd numbers out, order of the rest kept
+        const usize num_removed = array.remove_if([](u32 it) { return (it & 1) != 0; });
+        bool sorted_evens = num_removed == 28 && array.count == 29;
+        for (usize i = 1; i < array.count; i++) {
+            if ((array[i] & 1) || array[i] < array[i - 1]) sorted_evens = false;
+        }
+
+        array.remove_swap(0);
+        const bool swapped = array.count == 28 && array[0] == 62;
+
+        ch::Small_Array<Self_Ref, 4> refs;
+        defer(refs.free());
+        Self_Ref ref_items[16];
+        for (s32 i = 0; i < 16; i++) ref_items[i].value = i;
+        refs.push_range(ref_items, 16);
+        refs.remove_if([](const Self_Ref& it) { return it.value % 3 == 0; });
+        refs.remove_swap(0);
+        refs.remove_range(1, 2);
+
+        bool refs_in_place = refs.count == 7 && refs[0].value == 14 && refs[1].value == 5;
+        for (usize i = 0; i < refs.count; i++) {
+            if (refs[i].self != &refs[i]) refs_in_place = false;
+        }
+
+        if (!ranges_right || !sorted_evens || !swapped || !refs_in_place) {
+            TEST_FAIL("Array range operations are broken");
+        } else {
+            TEST_PASS("Array range operations");
+        }
+    }
+
+    {
+        u64 rng = 0x2545f4914f6cdd1dull;
+        auto next = [&]() {
+            rng ^= rng << 13;
+            rng ^= rng >> 7;
+            rng ^= rng << 17;
+            return rng;
+        };
+
+        const usize count = 10000;
+        ch::Array<s32> array;
+        defer(array.free());
+        for (usize i = 0; i < count; i++) array.push((s32)(next() % 2000) - 1000);
+
+        ch::Array<s32> copy = array.copy();
+        defer(copy.free());
+
+        bool sorted = true;
+        ch::sort(array);
+        for (usize i = 1; i < count; i++) {
+            if (array[i] < array[i - 1]) sorted = false;
+        }
+
+        ch::radix_sort(copy);
+        const bool radix_sorted = copy == array;
+
+        // Already sorted, reversed and all equal are the patterns that break a plain quicksort
+        ch::sort(array, ch::Greater<s32>());
+        bool reversed = true;
+        for (usize i = 1; i < count; i++) {
+            if (array[i] > array[i - 1]) reversed = false;
+        }
+        ch::sort(array);
+        const bool resorted = copy == array;
+
+        const usize num_floats = 8;
+        f32 floats[num_floats] = { 3.5f, -0.f, -2.f, 100.f, -100.5f, 0.f, 1e-30f, -1e30f };
+        ch::radix_sort(floats, num_floats);
+        bool floats_sorted = true;
+        for (usize i = 1; i < num_floats; i++) {
+            if (floats[i] < floats[i - 1]) floats_sorted = false;
+        }
+
+        if (!sorted || !radix_sorted || !reversed || !resorted || !floats_sorted) {
+            TEST_FAIL("Sort is broken");
+        } else {
+            TEST_PASS("Sort");
+        }
+
+        struct Keyed {
+            u32 key;
+            u32 order;
+        };
+
+        ch::Array<Keyed> keyed;
+        defer(keyed.free());
+        for (u32 i = 0; i < count; i++) keyed.push({ (u32)(next() % 64), i });
+        ch::Array<Keyed> keyed_copy = keyed.copy();
+        defer(keyed_copy.free());
+
+        ch::stable_sort(keyed, [](const Keyed& a, const Keyed& b) { return a.key < b.key; });
+        ch::radix_sort(keyed_copy, [](const Keyed& it) { return it.key; });
+
+        bool stable = true;
+        for (usize i = 1; i < count; i++) {
+            const Keyed& a = keyed[i - 1];
+            const Keyed& b = keyed[i];
+            if (a.key > b.key || (a.key == b.key && a.order > b.order)) stable = false;
+            if (keyed_copy[i].key != b.key || keyed_copy[i].order != b.order) stable = false;
+        }
+
+        if (!stable) {
+            TEST_FAIL("Stable sort is broken");
+        } else {
+            TEST_PASS("Stable sort");
+        }
+
+        for (usize i = 0; i < count; i++) array[i] = (s32)(next() % 2000) - 1000;
+        copy.count = 0;
+        copy.push_range(array.data, count);
+        ch::sort(copy);
+
+        bool selected = true;
+        const usize nths[] = { 0, 1, 17, count / 2, count - 2, count - 1 };
+        for (usize nth : nths) {
+            ch::nth_element(array.data, count, nth);
+            if (array[nth] != copy[nth]) selected = false;
+            for (usize i = 0; i < nth; i++) {
+                if (array[i] > array[nth]) selected = false;
+            }
+            for (usize i = nth + 1; i < count; i++) {
+                if (array[i] < array[nth]) selected = false;
+            }
+        }
+
+        ch::partial_sort(array.data, count, 100);
+        const bool partial = ch::mem_equal(array.data, copy.data, 100 * sizeof(s32));
+
+        if (!selected || !partial) {
+            TEST_FAIL("nth_element and partial_sort are broken");
+        } else {
+            TEST_PASS("nth_element and partial_sort");
+        }
+    }
+
+    {
+        // More threads than cores is fine. It still has to come out the same on a single core machine.
+        ch::Thread_Pool pool;
+        const bool made = ch::make_thread_pool(&pool, 3);
+        defer(ch::free_thread_pool(&pool));
+
+        volatile u64 sum = 0;
+        ch::parallel_for(&pool, 16, [&](usize i) {
+            ch::parallel_for(&pool, 64, [&](usize j) { ch::atomic_fetch_add(&sum, (u64)(i * 64 + j)); });
+        });
+        const bool nested = sum == 1024 * 1023 / 2;
+
+        u64 rng = 0x9e3779b97f4a7c15ull;
+        auto next = [&]() {
+            rng ^= rng << 13;
+            rng ^= rng >> 7;
+            rng ^= rng << 17;
+            return rng;
+        };
+
+        const usize count = 300000;
+        ch::Array<s32> array;
+        defer(array.free());
+        for (usize i = 0; i < count; i++) array.push((s32)next());
+
+        // Lots of duplicates so some splitters get buckets of their own
+        for (usize i = 0; i < count; i += 3) array[i] = (s32)(i % 5);
+
+        ch::Array<s32> expected = array.copy();
+        defer(expected.free());
+        ch::sort(expected);
+
+        ch::parallel_sort(array, &pool);
+        const bool sorted = array == expected;
+
+        struct Keyed {
+            u64 key;
+            u32 order;
+        };
+
+        ch::Array<Keyed> keyed;
+        defer(keyed.free());
+        for (u32 i = 0; i < count; i++) keyed.push({ next() & 0xff00ff00ffull, i });
+        ch::Array<Keyed> keyed_copy = keyed.copy();
+        defer(keyed_copy.free());
+
+        ch::radix_sort(keyed, [](const Keyed& it) { return it.key; });
+        ch::parallel_radix_sort(keyed_copy, [](const Keyed& it) { return it.key; }, &pool);
+        bool radix_sorted = true;
+        for (usize i = 0; i < count; i++) {
+            if (keyed[i].key != keyed_copy[i].key || keyed[i].order != keyed_copy[i].order) radix_sorted = false;
+        }
+
+        if (!made || !nested || !sorted || !radix_sorted) {
+            TEST_FAIL("Parallel sort is broken");
+        } else {
+            TEST_PASS("Parallel sort");
+        }
+    }
 }
 
 static void string_test() {
@@ -163,6 +1318,18 @@ static void string_test() {
 	} else {
 		TEST_PASS("String ends with");
 	}
+
+	if (foo.find_from_left('o') != 4 || foo.find_from_right('o') != 7 || foo.find_from_right('z') != -1) {
+		TEST_FAIL("String find is broken");
+	} else {
+		TEST_PASS("String find");
+	}
+
+	if (!ch::streq("hello world", "hello world") || ch::streq("hello", "hello world")) {
+		TEST_FAIL("streq is broken");
+	} else {
+		TEST_PASS("streq");
+	}
 }
 
 static void math_test() {
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "types.h"
+
+namespace ch {
+	using Thread_Func = void (*)(void* param);
+
+	struct Thread {
+		void* handle;
+
+		CH_FORCEINLINE explicit operator bool() const { return handle != nullptr; }
+	};
+
+	/** Implemented per platform */
+	bool create_thread(ch::Thread_Func func, void* param, ch::Thread* out_thread);
+	void join_thread(ch::Thread* thread);
+
+	/** Counting semaphore. Waiting while the count is zero puts the thread to sleep until it's signaled */
+	struct Semaphore {
+		void* handle;
+
+		CH_FORCEINLINE explicit operator bool() const { return handle != nullptr; }
+	};
+
+	/** Implemented per platform */
+	bool create_semaphore(u32 initial_count, ch::Semaphore* out_semaphore);
+	void free_semaphore(ch::Semaphore* semaphore);
+
+	/** Adds count and wakes up to that many waiting threads */
+	void signal_semaphore(ch::Semaphore* semaphore, u32 count = 1);
+
+	/** Takes one off the count, sleeping first if it's zero */
+	void wait_semaphore(ch::Semaphore* semaphore);
+
+	/** Gives the rest of this threads time slice to anything else that's ready to run */
+	void yield_thread();
+
+	u32 get_num_cpu_cores();
+}
@@ -0,0 +1,757 @@
+#include "thread_cache_allocator.h"
+#include "memory.h"
+#include "atomics.h"
+#include "bits.h"
+#include "thread.h"
+
+volatile u32 ch::priv_thread_cache_in_use = 0;
+
+const usize page_shift = 13;
+const usize page_size = (usize)1 << page_shift;
+
+const u32 num_size_classes = 40;
+
+/** Spans of up to this many pages get their own free list in the page heap. Bigger ones share one */
+const usize max_listed_pages = 128;
+
+/** Reserved from the os this much at a time */
+const usize system_chunk_size = 16 * 1024 * 1024;
+
+/** How many full batches each central list holds on to before objects go back to their spans */
+const u32 max_transfer_batches = 64;
+
+/**
+ * A thread frees a batch back to the central list once it holds this many batches of a class. Most of the time a
+ * thread that just freed a lot of something is about to allocate a lot of it again.
+ */
+const u32 max_cached_batches = 2;
+
+enum Span_State {
+	SS_Free,
+	SS_Small,
+	SS_Large,
+};
+
+struct Span {
+	usize start_page;
+	usize num_pages;
+	u32 size_class;
+	u32 state;
+
+	/** Objects in a small span that aren't handed out to anyone */
+	void* free_objects;
+	u32 num_allocated;
+
+	Span* next;
+	Span* prev;
+};
+
+static CH_FORCEINLINE usize get_page_id(const void* ptr) { return (usize)ptr >> page_shift; }
+static CH_FORCEINLINE u8* get_span_memory(const Span* span) { return (u8*)(span->start_page << page_shift); }
+
+static void list_push(Span** head, Span* span) {
+	span->prev = nullptr;
+	span->next = *head;
+	if (*head) (*head)->prev = span;
+	*head = span;
+}
+
+static void list_remove(Span** head, Span* span) {
+	if (span->prev) span->prev->next = span->next;
+	if (span->next) span->next->prev = span->prev;
+	if (*head == span) *head = span->next;
+	span->next = nullptr;
+	span->prev = nullptr;
+}
+
+/**
+ * Page map
+ *
+ * Two level radix tree over the 48 bit address space. The root is zero initialized static memory and leaves are
+ * reserved when a page in their range is first handed out. Reads don't take a lock. A pointer only gets to a reader
+ * after its pages have been set.
+ */
+const usize pagemap_bits = 48 - page_shift;
+const usize pagemap_leaf_bits = 18;
+const usize pagemap_root_bits = pagemap_bits - pagemap_leaf_bits;
+const usize pagemap_leaf_size = (usize)1 << pagemap_leaf_bits;
+
+static Span** volatile pagemap_root[(usize)1 << pagemap_root_bits];
+
+static CH_FORCEINLINE Span* pagemap_get(usize page) {
+	if (page >> pagemap_bits) return nullptr;
+
+	Span** leaf = ch::atomic_load(&pagemap_root[page >> pagemap_leaf_bits]);
+	if (!leaf) return nullptr;
+	return leaf[page & (pagemap_leaf_size - 1)];
+}
+
+/** Has to be called with the page heap lock held */
+static bool pagemap_set(usize page, Span* span) {
+	Span** volatile& leaf = pagemap_root[page >> pagemap_leaf_bits];
+	if (!leaf) {
+		// Only address space until it's touched so a whole leaf up front is fine
+		const usize leaf_bytes = pagemap_leaf_size * sizeof(Span*);
+		Span** new_leaf = (Span**)ch::reserve_memory(leaf_bytes);
+		if (!new_leaf || !ch::commit_memory(new_leaf, leaf_bytes)) return false;
+		ch::atomic_store(&leaf, new_leaf);
+	}
+
+	leaf[page & (pagemap_leaf_size - 1)] = span;
+	return true;
+}
+
+/**
+ * Page heap
+ *
+ * Hands out spans of whole pages and merges them back together when they're freed. Everything here is under one
+ * lock. The central lists only come here when they need a new span or have a completely free one.
+ */
+struct Page_Heap {
+	ch::Spin_Lock lock;
+
+	Span* free_lists[max_listed_pages + 1];
+	Span* large_free;
+
+	/** Span structs and thread caches are bumped out of here and recycled, never given back */
+	u8* metadata_current;
+	u8* metadata_end;
+	Span* free_spans;
+
+	usize system_bytes;
+	usize used_pages;
+	usize peak_used_pages;
+	usize num_failed_allocations;
+};
+
+static Page_Heap page_heap;
+
+/** Has to be called with the page heap lock held */
+static void* metadata_alloc(usize size) {
+	size = ch::align_up(size, 64);
+	if (page_heap.metadata_current + size > page_heap.metadata_end) {
+		const usize metadata_chunk_size = 1024 * 1024;
+		u8* memory = (u8*)ch::reserve_memory(metadata_chunk_size);
+		if (!memory || !ch::commit_memory(memory, metadata_chunk_size)) return nullptr;
+		page_heap.metadata_current = memory;
+		page_heap.metadata_end = memory + metadata_chunk_size;
+	}
+
+	void* result = page_heap.metadata_current;
+	page_heap.metadata_current += size;
+	return result;
+}
+
+static Span* new_span() {
+	Span* result = page_heap.free_spans;
+	if (result) {
+		page_heap.free_spans = result->next;
+	} else {
+		result = (Span*)metadata_alloc(sizeof(Span));
+		if (!result) return nullptr;
+	}
+
+	ch::mem_zero(result, sizeof(Span));
+	return result;
+}
+
+static void delete_span(Span* span) {
+	span->next = page_heap.free_spans;
+	page_heap.free_spans = span;
+}
+
+static CH_FORCEINLINE Span** get_free_list(usize num_pages) {
+	return num_pages <= max_listed_pages ? &page_heap.free_lists[num_pages] : &page_heap.large_free;
+}
+
+/** Free spans only need their first and last page mapped. That's all merging looks at */
+static bool set_span_ends(Span* span) {
+	return pagemap_set(span->start_page, span) && pagemap_set(span->start_page + span->num_pages - 1, span);
+}
+
+static void insert_free_span(Span* span) {
+	span->state = SS_Free;
+	span->size_class = 0;
+	list_push(get_free_list(span->num_pages), span);
+}
+
+static void release_span_locked(Span* span) {
+	// Merge with whatever free spans are right next to this one
+	Span* left = pagemap_get(span->start_page - 1);
+	if (left && left->state == SS_Free && left->start_page + left->num_pages == span->start_page) {
+		list_remove(get_free_list(left->num_pages), left);
+		span->start_page = left->start_page;
+		span->num_pages += left->num_pages;
+		delete_span(left);
+	}
+
+	Span* right = pagemap_get(span->start_page + span->num_pages);
+	if (right && right->state == SS_Free && right->start_page == span->start_page + span->num_pages) {
+		list_remove(get_free_list(right->num_pages), right);
+		span->num_pages += right->num_pages;
+		delete_span(right);
+	}
+
+	set_span_ends(span);
+	insert_free_span(span);
+}
+
+static bool grow_page_heap(usize num_pages) {
+	usize size = num_pages * page_size;
+	if (size < system_chunk_size) size = system_chunk_size;
+
+	u8* memory = (u8*)ch::reserve_memory(size);
+	if (!memory) return false;
+	if (!ch::commit_memory(memory, size)) {
+		ch::release_memory(memory, size);
+		return false;
+	}
+	page_heap.system_bytes += size;
+
+	// @NOTE(CHall): The os only promises page alignment for its pages. Ours are bigger so drop whatever is in front
+	u8* aligned = (u8*)ch::align_up(memory, page_size);
+	Span* span = new_span();
+	if (!span) return false;
+	span->start_page = get_page_id(aligned);
+	span->num_pages = (memory + size - aligned) / page_size;
+	if (!set_span_ends(span)) return false;
+
+	release_span_locked(span);
+	return true;
+}
+
+static Span* find_free_span(usize num_pages) {
+	for (usize i = num_pages; i <= max_listed_pages; i++) {
+		if (page_heap.free_lists[i]) return page_heap.free_lists[i];
+	}
+
+	// Best fit out of the big ones
+	Span* result = nullptr;
+	for (Span* it = page_heap.large_free; it; it = it->next) {
+		if (it->num_pages >= num_pages && (!result || it->num_pages < result->num_pages)) result = it;
+	}
+	return result;
+}
+
+/** Every page of the returned span is mapped to it */
+static Span* alloc_span(usize num_pages, u32 state, u32 size_class) {
+	page_heap.lock.lock_or_yield();
+	defer(page_heap.lock.unlock());
+
+	Span* span = find_free_span(num_pages);
+	if (!span) {
+		span = grow_page_heap(num_pages) ? find_free_span(num_pages) : nullptr;
+		if (!span) {
+			page_heap.num_failed_allocations += 1;
+			return nullptr;
+		}
+	}
+	list_remove(get_free_list(span->num_pages), span);
+
+	if (span->num_pages > num_pages) {
+		Span* rest = new_span();
+		if (rest) {
+			rest->start_page = span->start_page + num_pages;
+			rest->num_pages = span->num_pages - num_pages;
+			span->num_pages = num_pages;
+			set_span_ends(rest);
+			insert_free_span(rest);
+		}
+	}
+
+	span->state = state;
+	span->size_class = size_class;
+	page_heap.used_pages += span->num_pages;
+	if (page_heap.used_pages > page_heap.peak_used_pages) page_heap.peak_used_pages = page_heap.used_pages;
+
+	for (usize i = 0; i < span->num_pages; i++) {
+		if (!pagemap_set(span->start_page + i, span)) {
+			// Pages mapped so far still point at it which is fine for a free span. Only its ends get looked at.
+			page_heap.used_pages -= span->num_pages;
+			page_heap.num_failed_allocations += 1;
+			release_span_locked(span);
+			return nullptr;
+		}
+	}
+
+	return span;
+}
+
+static void release_span(Span* span) {
+	page_heap.lock.lock_or_yield();
+	defer(page_heap.lock.unlock());
+
+	page_heap.used_pages -= span->num_pages;
+	release_span_locked(span);
+}
+
+/**
+ * Size classes
+ *
+ * 16 byte steps up to 128 and then 4 classes per power of 2 up to thread_cache_max_small_size. Class 0 is unused so
+ * a span's size_class can tell small spans apart.
+ */
+struct Size_Class_Info {
+	u32 size;
+	u32 num_pages;
+	u32 batch_size;
+};
+
+static Size_Class_Info size_classes[num_size_classes + 1];
+static u8 small_size_to_class[1024 / 16 + 1];
+
+static CH_FORCEINLINE u32 get_size_class(usize size) {
+	if (size <= 1024) return small_size_to_class[(size + 15) >> 4];
+
+	const u32 level = ch::find_last_set((u64)(size - 1));
+	const u32 sub = (u32)((size - 1) >> (level - 2)) & 3;
+	return 1 + 8 + (level - 7) * 4 + sub;
+}
+
+static void init_size_classes() {
+	for (u32 i = 1; i <= num_size_classes; i++) {
+		const u32 index = i - 1;
+		u32 size;
+		if (index < 8) {
+			size = (index + 1) * 16;
+		} else {
+			const u32 level = 7 + (index - 8) / 4;
+			const u32 sub = (index - 8) % 4;
+			size = (1u << level) + (sub + 1) * (1u << (level - 2));
+		}
+
+		Size_Class_Info& info = size_classes[i];
+		info.size = size;
+
+		// Big enough spans that a span serves a decent number of objects without wasting much on the tail
+		usize span_bytes = (usize)size * 8;
+		if (span_bytes < 64 * 1024) span_bytes = 64 * 1024;
+		info.num_pages = (u32)(ch::align_up(span_bytes, page_size) / page_size);
+
+		u32 batch_size = (u32)(32 * 1024 / size);
+		if (batch_size < 2) batch_size = 2;
+		if (batch_size > 64) batch_size = 64;
+		info.batch_size = batch_size;
+	}
+
+	small_size_to_class[0] = 1;
+	for (usize i = 1; i < sizeof(small_size_to_class); i++) {
+		const usize size = i * 16;
+		u32 size_class = 1;
+		while (size_classes[size_class].size < size) size_class += 1;
+		small_size_to_class[i] = (u8)size_class;
+	}
+}
+
+/**
+ * Central free lists
+ *
+ * One per class. Full batches coming from threads are kept as is in the transfer slots. Anything else goes back to
+ * the span it came from and spans with nothing handed out go back to the page heap.
+ */
+struct Central_Free_List {
+	ch::Spin_Lock lock;
+	Span* nonempty;
+
+	void* batches[max_transfer_batches];
+	u32 num_batches;
+};
+
+static Central_Free_List central_lists[num_size_classes + 1];
+
+static CH_FORCEINLINE void*& get_next(void* object) {
+	return *(void**)object;
+}
+
+static bool populate_span(u32 size_class) {
+	const Size_Class_Info& info = size_classes[size_class];
+	Span* span = alloc_span(info.num_pages, SS_Small, size_class);
+	if (!span) return false;
+
+	u8* memory = get_span_memory(span);
+	const usize num_objects = (info.num_pages * page_size) / info.size;
+
+	void* head = nullptr;
+	for (usize i = num_objects; i > 0; i--) {
+		void* object = memory + (i - 1) * info.size;
+		get_next(object) = head;
+		head = object;
+	}
+
+	span->free_objects = head;
+	span->num_allocated = 0;
+	list_push(&central_lists[size_class].nonempty, span);
+	return true;
+}
+
+/** @returns how many objects were put in out_head. Up to batch_size */
+static u32 central_remove_batch(u32 size_class, void** out_head) {
+	Central_Free_List& list = central_lists[size_class];
+	const u32 batch_size = size_classes[size_class].batch_size;
+
+	list.lock.lock_or_yield();
+	defer(list.lock.unlock());
+
+	if (list.num_batches) {
+		list.num_batches -= 1;
+		*out_head = list.batches[list.num_batches];
+		return batch_size;
+	}
+
+	void* head = nullptr;
+	u32 count = 0;
+	while (count < batch_size) {
+		if (!list.nonempty && !populate_span(size_class)) break;
+
+		Span* span = list.nonempty;
+		while (span->free_objects && count < batch_size) {
+			void* object = span->free_objects;
+			span->free_objects = get_next(object);
+			get_next(object) = head;
+			head = object;
+			span->num_allocated += 1;
+			count += 1;
+		}
+
+		if (!span->free_objects) list_remove(&list.nonempty, span);
+	}
+
+	*out_head = head;
+	return count;
+}
+
+static void central_insert_range(u32 size_class, void* head, u32 count) {
+	Central_Free_List& list = central_lists[size_class];
+
+	list.lock.lock_or_yield();
+	defer(list.lock.unlock());
+
+	if (count == size_classes[size_class].batch_size && list.num_batches < max_transfer_batches) {
+		list.batches[list.num_batches] = head;
+		list.num_batches += 1;
+		return;
+	}
+
+	while (head) {
+		void* object = head;
+		head = get_next(object);
+
+		Span* span = pagemap_get(get_page_id(object));
+		if (!span->free_objects) list_push(&list.nonempty, span);
+		get_next(object) = span->free_objects;
+		span->free_objects = object;
+		span->num_allocated -= 1;
+
+		if (!span->num_allocated) {
+			list_remove(&list.nonempty, span);
+			release_span(span);
+		}
+	}
+}
+
+/**
+ * Thread caches
+ */
+struct Thread_Cache_List {
+	void* head;
+	u32 length;
+};
+
+struct Thread_Cache {
+	Thread_Cache_List lists[num_size_classes + 1];
+	Thread_Cache* next_free;
+};
+
+static Thread_Cache* free_thread_caches;
+
+static thread_local Thread_Cache* thread_cache = nullptr;
+static thread_local bool thread_cache_destroyed = false;
+
+static void flush_thread_cache(Thread_Cache* cache) {
+	for (u32 i = 1; i <= num_size_classes; i++) {
+		Thread_Cache_List& it = cache->lists[i];
+		if (it.head) central_insert_range(i, it.head, it.length);
+		it.head = nullptr;
+		it.length = 0;
+	}
+}
+
+/** Gives the cache back when its thread exits */
+struct Thread_Cache_Cleanup {
+	Thread_Cache* cache = nullptr;
+
+	~Thread_Cache_Cleanup() {
+		if (!cache) return;
+
+		flush_thread_cache(cache);
+		thread_cache = nullptr;
+		thread_cache_destroyed = true;
+
+		page_heap.lock.lock_or_yield();
+		cache->next_free = free_thread_caches;
+		free_thread_caches = cache;
+		page_heap.lock.unlock();
+	}
+};
+
+static thread_local Thread_Cache_Cleanup thread_cache_cleanup;
+
+static ch::Spin_Lock init_lock;
+static volatile u32 initialized = 0;
+
+static void init_thread_cache_allocator() {
+	init_lock.lock_or_yield();
+	defer(init_lock.unlock());
+
+	if (initialized) return;
+	init_size_classes();
+	ch::atomic_store(&initialized, 1);
+	ch::atomic_store(&ch::priv_thread_cache_in_use, 1);
+}
+
+static Thread_Cache* create_thread_cache() {
+	if (!ch::atomic_load(&initialized)) init_thread_cache_allocator();
+	if (thread_cache_destroyed) return nullptr;
+
+	Thread_Cache* result;
+	{
+		page_heap.lock.lock_or_yield();
+		defer(page_heap.lock.unlock());
+
+		result = free_thread_caches;
+		if (result) {
+			free_thread_caches = result->next_free;
+		} else {
+			result = (Thread_Cache*)metadata_alloc(sizeof(Thread_Cache));
+			if (!result) return nullptr;
+		}
+	}
+
+	ch::mem_zero(result, sizeof(Thread_Cache));
+	thread_cache = result;
+	thread_cache_cleanup.cache = result;
+	return result;
+}
+
+static void* alloc_large(usize size) {
+	if (!ch::atomic_load(&initialized)) init_thread_cache_allocator();
+
+	const usize num_pages = ch::align_up(size, page_size) / page_size;
+	Span* span = alloc_span(num_pages, SS_Large, 0);
+	if (!span) return nullptr;
+	return get_span_memory(span);
+}
+
+static void* alloc_small_slow(Thread_Cache* cache, u32 size_class) {
+	void* head;
+	const u32 count = central_remove_batch(size_class, &head);
+	if (!count) return nullptr;
+
+	void* result = head;
+	if (cache) {
+		Thread_Cache_List& list = cache->lists[size_class];
+		list.head = get_next(head);
+		list.length = count - 1;
+	} else if (count > 1) {
+		// No cache on a thread that's shutting down. Everything but the one we need goes straight back.
+		central_insert_range(size_class, get_next(head), count - 1);
+	}
+	return result;
+}
+
+void* ch::thread_cache_malloc(usize size) {
+	if (size > ch::thread_cache_max_small_size) return alloc_large(size);
+
+	Thread_Cache* cache = thread_cache;
+	if (!cache) {
+		cache = create_thread_cache();
+		if (!cache) {
+			if (!ch::atomic_load(&initialized)) return nullptr;
+			return alloc_small_slow(nullptr, get_size_class(size));
+		}
+	}
+
+	const u32 size_class = get_size_class(size);
+	Thread_Cache_List& list = cache->lists[size_class];
+	void* result = list.head;
+	if (result) {
+		list.head = get_next(result);
+		list.length -= 1;
+		return result;
+	}
+
+	return alloc_small_slow(cache, size_class);
+}
+
+static void free_small(void* ptr, u32 size_class) {
+	Thread_Cache* cache = thread_cache;
+	if (!cache) cache = create_thread_cache();
+	if (!cache) {
+		get_next(ptr) = nullptr;
+		central_insert_range(size_class, ptr, 1);
+		return;
+	}
+
+	Thread_Cache_List& list = cache->lists[size_class];
+	get_next(ptr) = list.head;
+	list.head = ptr;
+	list.length += 1;
+
+	const u32 batch_size = size_classes[size_class].batch_size;
+	if (list.length >= batch_size * max_cached_batches) {
+		// Hand back exactly one batch so it can sit in the transfer cache as is
+		void* batch = list.head;
+		void* last = batch;
+		for (u32 i = 1; i < batch_size; i++) {
+			last = get_next(last);
+		}
+		list.head = get_next(last);
+		list.length -= batch_size;
+		get_next(last) = nullptr;
+
+		central_insert_range(size_class, batch, batch_size);
+	}
+}
+
+void ch::thread_cache_free(void* ptr) {
+	if (!ptr) return;
+
+	Span* span = pagemap_get(get_page_id(ptr));
+	assert(span && span->state != SS_Free);
+
+	if (span->state == SS_Large) {
+		release_span(span);
+		return;
+	}
+
+	free_small(ptr, span->size_class);
+}
+
+void ch::thread_cache_free_sized(void* ptr, usize size) {
+	if (!ptr) return;
+
+	if (!size || size > ch::thread_cache_max_small_size) {
+		ch::thread_cache_free(ptr);
+		return;
+	}
+
+	const u32 size_class = get_size_class(size);
+#if CH_BUILD_DEBUG
+	assert(pagemap_get(get_page_id(ptr))->size_class == size_class);
+#endif
+	free_small(ptr, size_class);
+}
+
+usize ch::thread_cache_get_size(void* ptr) {
+	Span* span = pagemap_get(get_page_id(ptr));
+	assert(span);
+	if (span->state == SS_Large) return span->num_pages * page_size;
+	return size_classes[span->size_class].size;
+}
+
+void* ch::thread_cache_realloc(void* ptr, usize size) {
+	if (!ptr) return ch::thread_cache_malloc(size);
+
+	Span* span = pagemap_get(get_page_id(ptr));
+	assert(span && span->state != SS_Free);
+
+	// Stay put unless it's growing or would waste more than half of what it has. Small objects never leave their size
+	// class in place so a sized free can always work the class out from the size.
+	usize old_size;
+	if (span->state == SS_Large) {
+		old_size = span->num_pages * page_size;
+		if (size <= old_size && size >= old_size / 2 && size > ch::thread_cache_max_small_size) return ptr;
+	} else {
+		old_size = size_classes[span->size_class].size;
+		if (size <= ch::thread_cache_max_small_size && get_size_class(size) == span->size_class) return ptr;
+	}
+
+	void* result = ch::thread_cache_malloc(size);
+	if (!result) return nullptr;
+
+	ch::mem_copy(result, ptr, old_size < size ? old_size : size);
+	ch::thread_cache_free(ptr);
+	return result;
+}
+
+bool ch::priv_thread_cache_owns(void* ptr) {
+	return pagemap_get(get_page_id(ptr)) != nullptr;
+}
+
+/**
+ * Size classes are only 16 byte aligned and large spans are only page aligned. Anything over default_alignment is over
+ * allocated and the pointer underneath is stashed right before the aligned one like the heap allocator does.
+ */
+static void* thread_cache_alloc_over_aligned(void* ptr, usize old_size, usize size, usize alignment) {
+	const usize padding = alignment - 1 + sizeof(void*);
+	void* old_base = ptr ? ((void**)ptr)[-1] : nullptr;
+
+	if (!size) {
+		ch::thread_cache_free_sized(old_base, old_size ? old_size + padding : 0);
+		return nullptr;
+	}
+
+	u8* base = (u8*)ch::thread_cache_realloc(old_base, size + padding);
+	if (!base) return nullptr;
+	u8* result = (u8*)ch::align_up(base + sizeof(void*), alignment);
+
+	// @NOTE(CHall): realloc may have moved us to a base with a different offset to the next aligned address
+	if (ptr) {
+		const usize old_offset = (u8*)ptr - (u8*)old_base;
+		const usize new_offset = result - base;
+		if (old_offset != new_offset) ch::mem_move(result, base + old_offset, size);
+	}
+
+	((void**)result)[-1] = base;
+	return result;
+}
+
+static void* thread_cache_alloc(const ch::Allocator& allocator, void* ptr, usize old_size, usize size, usize alignment) {
+	if (alignment > ch::default_alignment) return thread_cache_alloc_over_aligned(ptr, old_size, size, alignment);
+
+	if (!size) {
+		ch::thread_cache_free_sized(ptr, old_size);
+		return nullptr;
+	}
+	return ch::thread_cache_realloc(ptr, size);
+}
+
+ch::Allocator_Stats ch::get_thread_cache_stats() {
+	page_heap.lock.lock_or_yield();
+	defer(page_heap.lock.unlock());
+
+	ch::Allocator_Stats result = {};
+	result.bytes_in_use = page_heap.used_pages * page_size;
+	result.peak_bytes_in_use = page_heap.peak_used_pages * page_size;
+	result.bytes_reserved = page_heap.system_bytes;
+	result.num_failed_allocations = page_heap.num_failed_allocations;
+
+	// How much of the free space is outside the single biggest free span
+	usize free_pages = 0;
+	usize largest_free = 0;
+	for (usize i = 1; i <= max_listed_pages; i++) {
+		for (Span* it = page_heap.free_lists[i]; it; it = it->next) {
+			free_pages += it->num_pages;
+			if (it->num_pages > largest_free) largest_free = it->num_pages;
+		}
+	}
+	for (Span* it = page_heap.large_free; it; it = it->next) {
+		free_pages += it->num_pages;
+		if (it->num_pages > largest_free) largest_free = it->num_pages;
+	}
+	if (free_pages) result.fragmentation = 1.f - (f32)largest_free / (f32)free_pages;
+
+	return result;
+}
+
+static ch::Allocator_Stats thread_cache_stats(const ch::Allocator& allocator) {
+	return ch::get_thread_cache_stats();
+}
+
+ch::Allocator ch::get_thread_cache_allocator() {
+	ch::Allocator result;
+	result.data = nullptr;
+	result.func = thread_cache_alloc;
+	result.stats_func = thread_cache_stats;
+	return result;
+}
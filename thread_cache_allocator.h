@@ -0,0 +1,51 @@
+#pragma once
+
+#include "allocator.h"
+
+/**
+ * Thread caching general purpose allocator
+ *
+ * Small sizes are rounded up to a size class. Every thread keeps a free list per class so most allocs and frees never
+ * touch a lock. When a thread runs dry or holds too much it moves a whole batch at a time to or from the central list
+ * for that class. The central lists hold on to a few full batches so handing them back and forth between threads is
+ * just swapping a pointer. Underneath everything memory is handed out in spans of whole pages taken from reserved
+ * virtual memory. A radix tree maps every page back to its span.
+ *
+ * Anything over thread_cache_max_small_size gets its own span straight from the page heap.
+ *
+ * Select it for ch::malloc with ch::set_malloc_backend(ch::MB_Thread_Cache) or use it through
+ * get_thread_cache_allocator.
+ */
+namespace ch {
+	const usize thread_cache_max_small_size = 32 * 1024;
+
+	void* thread_cache_malloc(usize size);
+	void* thread_cache_realloc(void* ptr, usize size);
+	void thread_cache_free(void* ptr);
+
+	/**
+	 * Same as thread_cache_free but small objects go straight to their size class without looking ptr up. size has to
+	 * be what ptr was last allocated or reallocated with.
+	 */
+	void thread_cache_free_sized(void* ptr, usize size);
+
+	/** Bytes that can actually be used at ptr. At least what was asked for */
+	usize thread_cache_get_size(void* ptr);
+
+	ch::Allocator get_thread_cache_allocator();
+
+	/**
+	 * In use is whole pages handed to size classes or large allocations, including objects sitting in thread caches.
+	 * Counts aren't tracked.
+	 */
+	ch::Allocator_Stats get_thread_cache_stats();
+
+	// @NOTE(CHall): Only exposed so ch::free can skip the lookup when the thread cache has never been used
+	extern volatile u32 priv_thread_cache_in_use;
+	bool priv_thread_cache_owns(void* ptr);
+
+	/** Whether ptr came from the thread cache allocator */
+	CH_FORCEINLINE bool thread_cache_owns(void* ptr) {
+		return ch::priv_thread_cache_in_use && ch::priv_thread_cache_owns(ptr);
+	}
+}
@@ -0,0 +1,181 @@
+#include "thread_pool.h"
+#include "memory.h"
+
+const usize initial_task_capacity = 64;
+
+static bool pop_task(ch::Thread_Pool* pool, ch::Pool_Task* out_task) {
+	pool->lock.lock_or_yield();
+	defer(pool->lock.unlock());
+
+	if (!pool->task_count) return false;
+
+	*out_task = pool->tasks[pool->task_head];
+	pool->task_head = (pool->task_head + 1) & (pool->task_capacity - 1);
+	pool->task_count -= 1;
+	return true;
+}
+
+/** @returns false when the queue is full and couldn't grow */
+static bool push_task(ch::Thread_Pool* pool, const ch::Pool_Task& task) {
+	pool->lock.lock_or_yield();
+	defer(pool->lock.unlock());
+
+	if (pool->task_count == pool->task_capacity) {
+		const usize new_capacity = pool->task_capacity * 2;
+		ch::Pool_Task* new_tasks = (ch::Pool_Task*)ch::os_malloc(new_capacity * sizeof(ch::Pool_Task));
+		if (!new_tasks) return false;
+
+		for (usize i = 0; i < pool->task_count; i++) {
+			new_tasks[i] = pool->tasks[(pool->task_head + i) & (pool->task_capacity - 1)];
+		}
+
+		ch::os_free(pool->tasks);
+		pool->tasks = new_tasks;
+		pool->task_capacity = new_capacity;
+		pool->task_head = 0;
+	}
+
+	const usize tail = (pool->task_head + pool->task_count) & (pool->task_capacity - 1);
+	pool->tasks[tail] = task;
+	pool->task_count += 1;
+	return true;
+}
+
+static void run_task(const ch::Pool_Task& task) {
+	task.func(task.param);
+	ch::atomic_fetch_add(&task.group->num_pending, (u32)-1);
+}
+
+static void worker_proc(void* param) {
+	ch::Thread_Pool* pool = (ch::Thread_Pool*)param;
+
+	while (true) {
+		ch::wait_semaphore(&pool->work_available);
+
+		// Every task signals once but whoever is waiting on a group can take it first
+		ch::Pool_Task task;
+		if (pop_task(pool, &task)) {
+			run_task(task);
+			continue;
+		}
+
+		if (ch::atomic_load(&pool->shutting_down)) return;
+	}
+}
+
+bool ch::make_thread_pool(ch::Thread_Pool* out_pool, u32 num_threads) {
+	if (!num_threads) {
+		num_threads = ch::get_num_cpu_cores() - 1;
+	}
+
+	ch::Thread_Pool& pool = *out_pool;
+	pool.threads = nullptr;
+	pool.num_threads = 0;
+	pool.lock.locked = 0;
+	pool.task_capacity = initial_task_capacity;
+	pool.task_head = 0;
+	pool.task_count = 0;
+	pool.shutting_down = 0;
+
+	pool.tasks = (ch::Pool_Task*)ch::os_malloc(pool.task_capacity * sizeof(ch::Pool_Task));
+	if (!pool.tasks) return false;
+
+	if (!ch::create_semaphore(0, &pool.work_available)) {
+		ch::os_free(pool.tasks);
+		return false;
+	}
+
+	if (num_threads) {
+		pool.threads = (ch::Thread*)ch::os_malloc(num_threads * sizeof(ch::Thread));
+		if (!pool.threads) {
+			ch::free_thread_pool(&pool);
+			return false;
+		}
+
+		for (u32 i = 0; i < num_threads; i++) {
+			if (!ch::create_thread(worker_proc, &pool, &pool.threads[i])) {
+				ch::free_thread_pool(&pool);
+				return false;
+			}
+			pool.num_threads += 1;
+		}
+	}
+
+	return true;
+}
+
+void ch::free_thread_pool(ch::Thread_Pool* pool) {
+	ch::atomic_store(&pool->shutting_down, 1);
+	ch::signal_semaphore(&pool->work_available, pool->num_threads);
+
+	for (u32 i = 0; i < pool->num_threads; i++) {
+		ch::join_thread(&pool->threads[i]);
+	}
+
+	if (pool->threads) ch::os_free(pool->threads);
+	ch::free_semaphore(&pool->work_available);
+	ch::os_free(pool->tasks);
+
+	pool->threads = nullptr;
+	pool->num_threads = 0;
+	pool->tasks = nullptr;
+	pool->task_capacity = 0;
+	pool->task_count = 0;
+}
+
+void ch::thread_pool_run(ch::Thread_Pool* pool, ch::Task_Group* group, ch::Thread_Func func, void* param) {
+	if (!pool->num_threads) {
+		func(param);
+		return;
+	}
+
+	// Counted before it's queued so a worker that finishes it straight away can't take the count below zero
+	ch::atomic_fetch_add(&group->num_pending, 1);
+	if (!push_task(pool, { func, param, group })) {
+		// @NOTE(CHall): The queue couldn't grow. Running it here is slower but the caller still gets its work done.
+		ch::atomic_fetch_add(&group->num_pending, (u32)-1);
+		func(param);
+		return;
+	}
+
+	ch::signal_semaphore(&pool->work_available);
+}
+
+void ch::thread_pool_wait(ch::Thread_Pool* pool, ch::Task_Group* group) {
+	u32 spins = 0;
+	while (ch::atomic_load(&group->num_pending)) {
+		ch::Pool_Task task;
+		if (pop_task(pool, &task)) {
+			run_task(task);
+			spins = 0;
+			continue;
+		}
+
+		// Nothing left to help with. The last few tasks in the group are running on other threads.
+		if (spins < 64) {
+			ch::cpu_relax();
+			spins += 1;
+		} else {
+			ch::yield_thread();
+		}
+	}
+}
+
+static ch::Thread_Pool shared_pool;
+static ch::Spin_Lock shared_pool_lock;
+static volatile u32 shared_pool_made = 0;
+
+ch::Thread_Pool* ch::get_thread_pool() {
+	if (!ch::atomic_load(&shared_pool_made)) {
+		shared_pool_lock.lock_or_yield();
+		defer(shared_pool_lock.unlock());
+
+		if (!shared_pool_made) {
+			const bool made = ch::make_thread_pool(&shared_pool);
+			assert(made);
+			ch::atomic_store(&shared_pool_made, 1);
+		}
+	}
+
+	return &shared_pool;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "thread.h"
+#include "atomics.h"
+
+/**
+ * Thread pool
+ *
+ * Workers pull tasks off one shared queue and sleep on a semaphore while it's empty. Every task belongs to a group so a
+ * caller can wait on just the tasks it started. Waiting runs queued tasks instead of sleeping which means the waiting
+ * thread counts as a worker and tasks can start and wait on tasks of their own.
+ *
+ * Meant for a handful of big tasks at a time like the chunks of a parallel sort. The queue takes a lock per task.
+ */
+namespace ch {
+	struct Task_Group {
+		volatile u32 num_pending = 0;
+	};
+
+	struct Pool_Task {
+		ch::Thread_Func func;
+		void* param;
+		ch::Task_Group* group;
+	};
+
+	struct Thread_Pool {
+		ch::Thread* threads;
+		u32 num_threads;
+
+		ch::Spin_Lock lock;
+
+		/** Ring buffer. capacity is always a power of two */
+		ch::Pool_Task* tasks;
+		usize task_capacity;
+		usize task_head;
+		usize task_count;
+
+		ch::Semaphore work_available;
+		volatile u32 shutting_down;
+
+		/** The pool's threads plus the one waiting on a group */
+		CH_FORCEINLINE u32 get_num_workers() const { return num_threads + 1; }
+	};
+
+	/**
+	 * num_threads of 0 means one less than the number of cores since whoever waits works too. A pool with no threads at
+	 * all is fine. Tasks just run right away on the thread that starts them.
+	 */
+	bool make_thread_pool(ch::Thread_Pool* out_pool, u32 num_threads = 0);
+
+	/** Runs whatever is still queued then joins every thread */
+	void free_thread_pool(ch::Thread_Pool* pool);
+
+	void thread_pool_run(ch::Thread_Pool* pool, ch::Task_Group* group, ch::Thread_Func func, void* param);
+
+	/** Runs queued tasks until every task in group is done */
+	void thread_pool_wait(ch::Thread_Pool* pool, ch::Task_Group* group);
+
+	/** Shared pool with a thread for every core but one. Made the first time it's asked for and never freed */
+	ch::Thread_Pool* get_thread_pool();
+
+	template <typename Func>
+	struct Parallel_For {
+		Func* func;
+		usize count;
+		volatile u64 next;
+
+		static void run(void* param) {
+			Parallel_For<Func>& it = *(Parallel_For<Func>*)param;
+			while (true) {
+				const u64 index = ch::atomic_fetch_add(&it.next, 1);
+				if (index >= it.count) break;
+				(*it.func)((usize)index);
+			}
+		}
+	};
+
+	/**
+	 * Calls func(index) for every index below count on the pool's threads and this one. Indices are handed out one at a
+	 * time as threads finish their last one so uneven work still balances out.
+	 */
+	template <typename Func>
+	void parallel_for(ch::Thread_Pool* pool, usize count, Func func) {
+		if (!count) return;
+
+		Parallel_For<Func> state = { &func, count, 0 };
+		ch::Task_Group group;
+
+		const usize num_helpers = count - 1 < pool->num_threads ? count - 1 : pool->num_threads;
+		for (usize i = 0; i < num_helpers; i++) {
+			ch::thread_pool_run(pool, &group, &Parallel_For<Func>::run, &state);
+		}
+
+		Parallel_For<Func>::run(&state);
+		ch::thread_pool_wait(pool, &group);
+	}
+}
@@ -135,4 +135,7 @@ namespace ch {
 	};
 
 	extern ch::Scoped_Timer_Manager scoped_timer_manager;
-}
\ No newline at end of file
+}
+
+// @NOTE(CHall): Timers get pushed into the manager by value. Moving them around mustn't run the destructor
+CH_TRIVIALLY_RELOCATABLE(ch::Scoped_Timer);
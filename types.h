@@ -5,12 +5,19 @@
 using u8  = unsigned char;
 using u16 = unsigned short;
 using u32 = unsigned int;
-using u64 = unsigned long long;
 
 using s8  = signed char;
 using s16 = signed short;
 using s32 = signed int;
+
+// @NOTE(CHall): long is 64 bit everywhere but windows. Has to match size_t or operator new and friends won't line up.
+#if CH_PLATFORM_64BIT && !CH_PLATFORM_WINDOWS
+using u64 = unsigned long;
+using s64 = signed long;
+#else
+using u64 = unsigned long long;
 using s64 = signed long long;
+#endif
 
 #define CH_STRINGIZE(x) CH_STRINGIZE2(x)
 #define CH_STRINGIZE2(x) #x
@@ -1,4 +1,5 @@
 #include "../memory.h"
+#include "../heap_profiler.h"
 
 #if !CH_PLATFORM_WINDOWS
 #error This should not be compiling on this platform
@@ -9,15 +10,58 @@
 #define NOMINMAX
 #include <windows.h>
 
-void* ch::malloc(usize size) {
+void* ch::os_malloc(usize size) {
     return HeapAlloc(GetProcessHeap(), 0, size);
 }
 
-void* ch::realloc(void* ptr, usize size) {
+void* ch::os_realloc(void* ptr, usize size) {
     return HeapReAlloc(GetProcessHeap(), 0, ptr, size);
 }
 
-void ch::free(void* ptr) {
+void ch::os_free(void* ptr) {
     HeapFree(GetProcessHeap(), 0, ptr);
 }
 
+void ch::get_os_heap_usage(usize* out_bytes_in_use, usize* out_bytes_reserved) {
+    HEAP_SUMMARY summary = {};
+    summary.cb = sizeof(summary);
+    if (!HeapSummary(GetProcessHeap(), 0, &summary)) {
+        *out_bytes_in_use = 0;
+        *out_bytes_reserved = 0;
+        return;
+    }
+
+    *out_bytes_in_use = summary.cbAllocated;
+    *out_bytes_reserved = summary.cbCommitted;
+}
+
+u32 ch::capture_stack_trace(void** out_frames, u32 max_frames, u32 frames_to_skip) {
+    return RtlCaptureStackBackTrace(frames_to_skip + 1, max_frames, out_frames, nullptr);
+}
+
+usize ch::get_page_size() {
+    static usize page_size = 0;
+    if (!page_size) {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        page_size = info.dwPageSize;
+    }
+    return page_size;
+}
+
+void* ch::reserve_memory(usize size, u32 flags) {
+    // @NOTE(CHall): Large pages on windows need a privilege and have to be committed up front so VMF_Huge_Pages is ignored
+    return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+bool ch::commit_memory(void* ptr, usize size) {
+    return VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+}
+
+void ch::decommit_memory(void* ptr, usize size) {
+    VirtualFree(ptr, size, MEM_DECOMMIT);
+}
+
+void ch::release_memory(void* ptr, usize size) {
+    VirtualFree(ptr, 0, MEM_RELEASE);
+}
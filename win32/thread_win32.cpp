@@ -0,0 +1,77 @@
+#include "../thread.h"
+#include "../memory.h"
+
+#if !CH_PLATFORM_WINDOWS
+#error This should not be compiling on this platform
+#endif
+
+#define WIN32_MEAN_AND_LEAN
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+struct Thread_Start {
+    ch::Thread_Func func;
+    void* param;
+};
+
+static DWORD WINAPI thread_proc(LPVOID param) {
+    Thread_Start start = *(Thread_Start*)param;
+    ch::os_free(param);
+
+    start.func(start.param);
+    return 0;
+}
+
+bool ch::create_thread(ch::Thread_Func func, void* param, ch::Thread* out_thread) {
+    Thread_Start* start = (Thread_Start*)ch::os_malloc(sizeof(Thread_Start));
+    if (!start) return false;
+    start->func = func;
+    start->param = param;
+
+    HANDLE handle = CreateThread(nullptr, 0, thread_proc, start, 0, nullptr);
+    if (!handle) {
+        ch::os_free(start);
+        return false;
+    }
+
+    out_thread->handle = handle;
+    return true;
+}
+
+void ch::join_thread(ch::Thread* thread) {
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    thread->handle = nullptr;
+}
+
+bool ch::create_semaphore(u32 initial_count, ch::Semaphore* out_semaphore) {
+    HANDLE handle = CreateSemaphoreA(nullptr, (LONG)initial_count, MAXLONG, nullptr);
+    if (!handle) return false;
+
+    out_semaphore->handle = handle;
+    return true;
+}
+
+void ch::free_semaphore(ch::Semaphore* semaphore) {
+    CloseHandle(semaphore->handle);
+    semaphore->handle = nullptr;
+}
+
+void ch::signal_semaphore(ch::Semaphore* semaphore, u32 count) {
+    if (count) ReleaseSemaphore(semaphore->handle, (LONG)count, nullptr);
+}
+
+void ch::wait_semaphore(ch::Semaphore* semaphore) {
+    WaitForSingleObject(semaphore->handle, INFINITE);
+}
+
+void ch::yield_thread() {
+    SwitchToThread();
+}
+
+u32 ch::get_num_cpu_cores() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (u32)info.dwNumberOfProcessors;
+}